@@ -0,0 +1,274 @@
+/*
+
+File: csr_elementwise.hpp
+
+Brief: Merge based elementwise operations between CSR matrices
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#ifndef CSR_ELEMENTWISE_CPP_H
+#define CSR_ELEMENTWISE_CPP_H
+
+#include <vector>
+#include <numeric>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+
+#include <fmatrix.hpp>
+#include <parallel.hpp>
+#include <csr_matrix.hpp>
+#include <reordering.hpp>
+
+/*
+ * Elementwise operations run in two passes. The symbolic pass merges the
+ * column lists of the inputs to size the output pattern exactly. The numeric
+ * pass then walks any output pattern and fills each entry with op(a, b),
+ * treating entries missing from an input as zero. When the input patterns
+ * stay fixed between calls, the symbolic result can be kept and only the
+ * numeric pass repeated. Identical input patterns skip the merge entirely.
+ *
+ * Results keep every structural entry of the merged pattern, so A - A
+ * stores explicit zeros and CSRMatrix::operator== compares it unequal to an
+ * empty matrix. prune() drops them. Both passes split rows across threads by
+ * nonzeros.
+ */
+enum class SparsityMerge { Union, Intersection };
+
+namespace detail
+{
+
+template <unsigned n, unsigned m>
+bool same_pattern(const CSRMatrix<n,m>& A, const CSRMatrix<n,m>& B) noexcept
+{
+    return std::equal(A._row, A._row + n + 1, B._row) && A._cols == B._cols;
+}
+
+// Visits the merged column list of row i of A and B
+template <unsigned n, unsigned m, typename Visit>
+void merge_row(const CSRMatrix<n,m>& A, const CSRMatrix<n,m>& B, unsigned i,
+               SparsityMerge merge, Visit&& visit)
+{
+    unsigned a = A._row[i], a_end = A._row[i+1];
+    unsigned b = B._row[i], b_end = B._row[i+1];
+
+    while (a < a_end && b < b_end)
+    {
+        const unsigned ca = A._cols[a];
+        const unsigned cb = B._cols[b];
+        if (ca == cb)
+        {
+            visit(ca);
+            ++a; ++b;
+        }
+        else if (ca < cb)
+        {
+            if (merge == SparsityMerge::Union) { visit(ca); }
+            ++a;
+        }
+        else
+        {
+            if (merge == SparsityMerge::Union) { visit(cb); }
+            ++b;
+        }
+    }
+    if (merge == SparsityMerge::Union)
+    {
+        for (; a < a_end; ++a) { visit(A._cols[a]); }
+        for (; b < b_end; ++b) { visit(B._cols[b]); }
+    }
+}
+
+template <unsigned n, unsigned m>
+unsigned row_threads(const CSRMatrix<n,m>& A, unsigned threads, std::vector<unsigned>& bounds)
+{
+    threads = std::max(1u, std::min(threads, n));
+    bounds  = nnz_partition(A, threads);
+    return threads;
+}
+
+} // namespace detail
+
+/* Output pattern of merging A and B, values are zero initialized */
+template <unsigned n, unsigned m>
+CSRMatrix<n,m> elementwise_symbolic(const CSRMatrix<n,m>& A, const CSRMatrix<n,m>& B,
+                                    SparsityMerge merge, unsigned threads = 1)
+{
+    CSRMatrix<n,m> C;
+    if (detail::same_pattern(A, B))
+    {
+        std::copy(A._row, A._row + n + 1, C._row);
+        C._cols = A._cols;
+        C._vals.assign(A.nnz(), 0.0);
+        return C;
+    }
+
+    std::vector<unsigned> bounds;
+    threads = detail::row_threads(A.nnz() > B.nnz() ? A : B, threads, bounds);
+
+    // Count each row, then convert the counts to offsets
+    detail::for_each_chunk(threads, [&](unsigned t)
+    {
+        for (unsigned i = bounds[t]; i < bounds[t+1]; ++i)
+        {
+            unsigned count = 0;
+            detail::merge_row(A, B, i, merge, [&count](unsigned) { ++count; });
+            C._row[i+1] = count;
+        }
+    });
+    std::partial_sum(C._row, C._row + n + 1, C._row);
+
+    C._cols.resize(C._row[n]);
+    C._vals.assign(C._row[n], 0.0);
+
+    detail::for_each_chunk(threads, [&](unsigned t)
+    {
+        for (unsigned i = bounds[t]; i < bounds[t+1]; ++i)
+        {
+            unsigned k = C._row[i];
+            detail::merge_row(A, B, i, merge, [&](unsigned j) { C._cols[k++] = j; });
+        }
+    });
+    return C;
+}
+
+/*
+ * Fills C(i, j) = op(A(i, j), B(i, j)) for every entry in the existing
+ * pattern of C, typically the result of elementwise_symbolic.
+ */
+template <unsigned n, unsigned m, typename Op>
+void elementwise_numeric(CSRMatrix<n,m>& C, const CSRMatrix<n,m>& A, const CSRMatrix<n,m>& B,
+                         Op op, unsigned threads = 1)
+{
+    if (detail::same_pattern(C, A) && detail::same_pattern(C, B))
+    {
+        // Value arrays line up, split them evenly without a row partition
+        const unsigned long long nnz = C.nnz();
+        threads = static_cast<unsigned>(std::max(1ull, std::min<unsigned long long>(threads, nnz)));
+
+        detail::for_each_chunk(threads, [&](unsigned t)
+        {
+            const auto first = (nnz * t) / threads;
+            const auto last  = (nnz * (t + 1)) / threads;
+            std::transform(A._vals.begin() + first, A._vals.begin() + last,
+                           B._vals.begin() + first, C._vals.begin() + first, op);
+        });
+        return;
+    }
+
+    std::vector<unsigned> bounds;
+    threads = detail::row_threads(C, threads, bounds);
+
+    detail::for_each_chunk(threads, [&](unsigned t)
+    {
+        for (unsigned i = bounds[t]; i < bounds[t+1]; ++i)
+        {
+            unsigned a = A._row[i], a_end = A._row[i+1];
+            unsigned b = B._row[i], b_end = B._row[i+1];
+            for (unsigned k = C._row[i]; k < C._row[i+1]; ++k)
+            {
+                const unsigned j = C._cols[k];
+                while (a < a_end && A._cols[a] < j) { ++a; }
+                while (b < b_end && B._cols[b] < j) { ++b; }
+
+                const double x = (a < a_end && A._cols[a] == j) ? A._vals[a] : 0.0;
+                const double y = (b < b_end && B._cols[b] == j) ? B._vals[b] : 0.0;
+                C._vals[k] = op(x, y);
+            }
+        }
+    });
+}
+
+/* Removes explicitly stored zeros from A in place, returning A */
+template <unsigned n, unsigned m>
+CSRMatrix<n,m>& prune(CSRMatrix<n,m>& A)
+{
+    unsigned out = 0;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        const unsigned first = A._row[i];
+        const unsigned last  = A._row[i+1];
+
+        A._row[i] = out;
+        for (unsigned k = first; k < last; ++k)
+        {
+            if (A._vals[k] == 0) { continue; }
+
+            A._cols[out] = A._cols[k];
+            A._vals[out] = A._vals[k];
+            ++out;
+        }
+    }
+    A._row[n] = out;
+    A._cols.resize(out);
+    A._vals.resize(out);
+    return A;
+}
+
+/** ARITHMETIC OPERATIONS **/
+
+template <unsigned n, unsigned m>
+CSRMatrix<n,m> add(const CSRMatrix<n,m>& A, const CSRMatrix<n,m>& B, unsigned threads = 1)
+{
+    CSRMatrix<n,m> C = elementwise_symbolic(A, B, SparsityMerge::Union, threads);
+    elementwise_numeric(C, A, B, std::plus<double>(), threads);
+    return C;
+}
+
+template <unsigned n, unsigned m>
+CSRMatrix<n,m> subtract(const CSRMatrix<n,m>& A, const CSRMatrix<n,m>& B, unsigned threads = 1)
+{
+    CSRMatrix<n,m> C = elementwise_symbolic(A, B, SparsityMerge::Union, threads);
+    elementwise_numeric(C, A, B, std::minus<double>(), threads);
+    return C;
+}
+
+template <unsigned n, unsigned m>
+CSRMatrix<n,m> hadamard(const CSRMatrix<n,m>& A, const CSRMatrix<n,m>& B, unsigned threads = 1)
+{
+    CSRMatrix<n,m> C = elementwise_symbolic(A, B, SparsityMerge::Intersection, threads);
+    elementwise_numeric(C, A, B, std::multiplies<double>(), threads);
+    return C;
+}
+
+/* Entries of A where the mask M stores an entry, the values of M are ignored */
+template <unsigned n, unsigned m>
+CSRMatrix<n,m> mask(const CSRMatrix<n,m>& A, const CSRMatrix<n,m>& M, unsigned threads = 1)
+{
+    CSRMatrix<n,m> C = elementwise_symbolic(A, M, SparsityMerge::Intersection, threads);
+    elementwise_numeric(C, A, M, [](double a, double) { return a; }, threads);
+    return C;
+}
+
+/* Hadamard product of A and B computed only where the mask M stores an entry */
+template <unsigned n, unsigned m>
+CSRMatrix<n,m> masked_hadamard(const CSRMatrix<n,m>& A, const CSRMatrix<n,m>& B,
+                               const CSRMatrix<n,m>& M, unsigned threads = 1)
+{
+    CSRMatrix<n,m> C = elementwise_symbolic(A, M, SparsityMerge::Intersection, threads);
+    C = elementwise_symbolic(C, B, SparsityMerge::Intersection, threads);
+    elementwise_numeric(C, A, B, std::multiplies<double>(), threads);
+    return C;
+}
+
+template <unsigned n, unsigned m>
+CSRMatrix<n,m> operator+(const CSRMatrix<n,m>& A, const CSRMatrix<n,m>& B)
+{
+    return add(A, B);
+}
+
+/*
+ * Keeps cancelled entries as explicit zeros, so == on the result is
+ * structural: (A - A) != CSRMatrix<n,m>() until the result is pruned.
+ */
+template <unsigned n, unsigned m>
+CSRMatrix<n,m> operator-(const CSRMatrix<n,m>& A, const CSRMatrix<n,m>& B)
+{
+    return subtract(A, B);
+}
+
+#endif // CSR_ELEMENTWISE_CPP_H
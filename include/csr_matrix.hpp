@@ -10,11 +10,34 @@ https://github.com/AlexanderJDupree/matrix-cpp
  
 */
 
+#ifndef CSR_MATRIX_CPP_H
+#define CSR_MATRIX_CPP_H
+
 #include <vector>
 #include <algorithm>
 #include <initializer_list>
 
 #include <fmatrix.hpp>
+#include <kernel_scope.hpp>
+
+namespace detail
+{
+
+// Bytes of an n row CSR matrix holding nnz entries
+template <unsigned n>
+constexpr double csr_bytes(unsigned nnz) noexcept
+{
+    return (sizeof(double) + sizeof(unsigned)) * double(nnz) + sizeof(unsigned) * (n + 1.0);
+}
+
+// Compulsory bytes of C(n x p) = A(n x m) * B(m x p) for a CSR A holding nnz entries
+template <unsigned n, unsigned m, unsigned p>
+constexpr double csr_multiply_bytes(unsigned nnz) noexcept
+{
+    return csr_bytes<n>(nnz) + sizeof(double) * ((double(m) * p) + (double(n) * p));
+}
+
+} // namespace detail
 
 template <unsigned n, unsigned m>
 class CSRMatrix
@@ -48,6 +71,10 @@ public:
     FMatrix<n, p> multiply (const FMatrix<m, p>& rhs) const;
     template <unsigned p>
     FMatrix<n, p> operator* (const FMatrix<m, p>& rhs) const;
+    template <unsigned p, typename V>
+    FMatrix<n, p> multiply (const MatrixView<m, p, V>& rhs) const;
+    template <unsigned p, typename V>
+    FMatrix<n, p> operator* (const MatrixView<m, p, V>& rhs) const { return multiply(rhs); }
     template <unsigned v, unsigned w, unsigned p>
     friend FMatrix<v, p> operator*(FMatrix<v,w>, const CSRMatrix<w,p>&);
 
@@ -64,6 +91,8 @@ public:
 template <unsigned n, unsigned m>
 CSRMatrix<n,m>::CSRMatrix(FMatrix<n,m> A)
 {
+    MATRIX_CPP_KERNEL_SCOPE("CSRMatrix::CSRMatrix", n, m);
+
     // Worst case scenario, we were handed a dense matrix
     _vals.reserve(n*m);
     _cols.reserve(n*m);
@@ -86,11 +115,15 @@ CSRMatrix<n,m>::CSRMatrix(FMatrix<n,m> A)
 
     _vals.shrink_to_fit();
     _cols.shrink_to_fit();
+
+    MATRIX_CPP_KERNEL_WORK(0, detail::csr_bytes<n>(nnz()) + sizeof(double) * (double(n) * m), nnz());
 }
 
 template <unsigned n, unsigned m>
 CSRMatrix<n,m>::CSRMatrix(std::initializer_list<double> il)
 {
+    MATRIX_CPP_KERNEL_SCOPE("CSRMatrix::CSRMatrix", n, m);
+
     // Worst case scenario, we were handed a dense matrix
     _vals.reserve(n*m);
     _cols.reserve(n*m);
@@ -114,6 +147,8 @@ CSRMatrix<n,m>::CSRMatrix(std::initializer_list<double> il)
 
     _vals.shrink_to_fit();
     _cols.shrink_to_fit();
+
+    MATRIX_CPP_KERNEL_WORK(0, detail::csr_bytes<n>(nnz()) + sizeof(double) * (double(n) * m), nnz());
 }
 
 template <unsigned n, unsigned m>
@@ -134,6 +169,8 @@ FMatrix<n,m> CSRMatrix<n,m>::to_fmatrix() const
 template<unsigned n, unsigned m>
 CSRMatrix<m, n> CSRMatrix<n,m>::transpose() const
 {
+    MATRIX_CPP_KERNEL_SCOPE("CSRMatrix::transpose", m, n, 0, 0,
+                            detail::csr_bytes<n>(nnz()) + sizeof(double) * (double(n) * m), nnz());
     FMatrix<m,n> T;
 
     for(unsigned i = 0; i < n; ++i)
@@ -178,24 +215,73 @@ CSRMatrix<v, w> operator*(double scalar, const CSRMatrix<v,w>& rhs)
     return rhs * scalar;
 }
 
-template <unsigned n, unsigned m>
-template <unsigned p>
-FMatrix<n, p> CSRMatrix<n,m>::multiply (const FMatrix<m, p>& B) const
+namespace detail
 {
-    FMatrix<n,p> C;
 
-    for(unsigned i = 0; i < n; ++i)
+// Rows [first, last) of C = A * B where A is given by its raw CSR arrays.
+// Shared by every CSR storage type so owning and mapped matrices run the
+// same kernel, and by threaded callers that split the rows between them.
+template <unsigned n, unsigned m, unsigned p>
+void csr_multiply_rows(const unsigned* row, const unsigned* cols, const double* vals,
+                       ConstFMatrixView<m, p> B, FMatrixView<n, p> C,
+                       unsigned first, unsigned last)
+{
+    const bool unit_stride = B._col_stride == 1 && C._col_stride == 1;
+
+    for(unsigned i = first; i < last; ++i)
     {
-        for (unsigned j = 0; j < p; ++j)
+        double* c = &C.at_unsafe(i, 0);
+        for (unsigned j = 0; j < p; ++j) { c[j * C._col_stride] = 0; }
+
+        for (unsigned k = row[i]; k < row[i+1]; ++k)
         {
-            double sum = 0;
-            for (unsigned k = _row[i]; k < _row[i+1]; ++k)
+            const double  a = vals[k];
+            const double* b = &B.at_unsafe(cols[k], 0);
+            if (unit_stride)
             {
-                sum += _vals[k] * B[_cols[k]][j];
+                for (unsigned j = 0; j < p; ++j) { c[j] += a * b[j]; }
+            }
+            else
+            {
+                for (unsigned j = 0; j < p; ++j)
+                {
+                    c[j * C._col_stride] += a * b[j * B._col_stride];
+                }
             }
-            C[i][j] = sum;
         }
     }
+}
+
+// Every CSR storage type multiplies through here, so the kernel is
+// instrumented once for all of them
+template <unsigned n, unsigned m, unsigned p>
+void csr_multiply(const unsigned* row, const unsigned* cols, const double* vals,
+                  ConstFMatrixView<m, p> B, FMatrixView<n, p> C)
+{
+    MATRIX_CPP_KERNEL_SCOPE("CSRMatrix::multiply", n, p, m, 2.0 * row[n] * p,
+                            csr_multiply_bytes<n, m, p>(row[n]), row[n]);
+    csr_multiply_rows<n, m, p>(row, cols, vals, B, C, 0, n);
+}
+
+} // namespace detail
+
+template <unsigned n, unsigned m>
+template <unsigned p>
+FMatrix<n, p> CSRMatrix<n,m>::multiply (const FMatrix<m, p>& B) const
+{
+    FMatrix<n,p> C;
+
+    detail::csr_multiply<n, m, p>(_row, _cols.data(), _vals.data(), B.view(), C.view());
+    return C;
+}
+
+template <unsigned n, unsigned m>
+template <unsigned p, typename V>
+FMatrix<n, p> CSRMatrix<n,m>::multiply (const MatrixView<m, p, V>& B) const
+{
+    FMatrix<n,p> C;
+
+    detail::csr_multiply<n, m, p>(_row, _cols.data(), _vals.data(), B, C.view());
     return C;
 }
 
@@ -222,3 +308,4 @@ bool CSRMatrix<n,m>::operator != (const CSRMatrix<n, m>& rhs) const noexcept
     return !(*this == rhs);
 }
 
+#endif // CSR_MATRIX_CPP_H
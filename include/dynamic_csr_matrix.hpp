@@ -0,0 +1,337 @@
+/*
+
+File: dynamic_csr_matrix.hpp
+
+Brief: CSR matrix supporting incremental insertion and deletion of entries
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#ifndef DYNAMIC_CSR_MATRIX_CPP_H
+#define DYNAMIC_CSR_MATRIX_CPP_H
+
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include <algorithm>
+
+#include <fmatrix.hpp>
+#include <csr_matrix.hpp>
+
+/*
+ * A CSR matrix with an updatable structure. Changes are layered over an
+ * immutable base CSRMatrix:
+ *
+ *   - Updating a stored entry writes the base value in place.
+ *   - Erasing a stored entry zeroes it and marks it erased, so base kernels
+ *     still run unchanged over the base arrays.
+ *   - New entries go into a per-row delta kept sorted by column.
+ *
+ * Reads and products merge the base and delta on the fly. Once the number of
+ * pending changes exceeds a fraction of the stored entries the matrix
+ * compacts, folding the deltas into a fresh base. Compaction copies runs of
+ * untouched rows in bulk and only merges the rows that changed.
+ */
+template <unsigned n, unsigned m>
+class DynamicCSRMatrix
+{
+public:
+
+    using Entry = std::pair<unsigned, double>; // (column, value)
+
+    DynamicCSRMatrix() : DynamicCSRMatrix(CSRMatrix<n,m>()) {}
+    DynamicCSRMatrix(CSRMatrix<n,m> base, double compaction_ratio = 0.1);
+
+    /* Data Access Methods */
+    double at(unsigned i, unsigned j) const;
+    bool   contains(unsigned i, unsigned j) const;
+
+    unsigned nnz()     const noexcept { return _base.nnz() - _erased_count + _inserted_count; }
+    unsigned pending() const noexcept { return _erased_count + _inserted_count; }
+
+    /* Structural Updates */
+    void set  (unsigned i, unsigned j, double value);
+    bool erase(unsigned i, unsigned j);
+
+    void compact();
+
+    CSRMatrix<n,m> to_csr() const;
+    FMatrix<n,m>   to_fmatrix() const;
+
+    /* Arithmetic Operations */
+    template <unsigned p, typename V>
+    FMatrix<n, p> multiply (const MatrixView<m, p, V>& rhs) const;
+    template <unsigned p, typename V>
+    FMatrix<n, p> operator* (const MatrixView<m, p, V>& rhs) const { return multiply(rhs); }
+
+    template <unsigned p>
+    FMatrix<n, p> multiply (const FMatrix<m, p>& rhs) const { return multiply(rhs.view()); }
+    template <unsigned p>
+    FMatrix<n, p> operator* (const FMatrix<m, p>& rhs) const { return multiply(rhs); }
+
+    CSRMatrix<n,m>                  _base;
+    std::vector<bool>               _erased; // _erased[k] ==> _base entry k was removed
+    std::vector<std::vector<Entry>> _delta;  // Inserted entries, sorted by column
+    std::vector<bool>               _dirty;  // Rows with erased or inserted entries
+
+    double   _compaction_ratio = 0.1;
+    unsigned _erased_count     = 0;
+    unsigned _inserted_count   = 0;
+
+private:
+
+    void check_bounds(unsigned i, unsigned j) const;
+    void maybe_compact();
+
+    // Position of (i, j) in the base arrays, or _base.nnz() if not stored
+    unsigned find_base(unsigned i, unsigned j) const noexcept;
+};
+
+template <unsigned n, unsigned m>
+DynamicCSRMatrix<n,m>::DynamicCSRMatrix(CSRMatrix<n,m> base, double compaction_ratio)
+    : _base(std::move(base))
+    , _erased(_base.nnz(), false)
+    , _delta(n)
+    , _dirty(n, false)
+    , _compaction_ratio(compaction_ratio)
+{}
+
+template <unsigned n, unsigned m>
+void DynamicCSRMatrix<n,m>::check_bounds(unsigned i, unsigned j) const
+{
+    if(i >= n || j >= m) { throw std::out_of_range("Matrix index out of range"); }
+}
+
+template <unsigned n, unsigned m>
+unsigned DynamicCSRMatrix<n,m>::find_base(unsigned i, unsigned j) const noexcept
+{
+    auto first = _base._cols.begin() + _base._row[i];
+    auto last  = _base._cols.begin() + _base._row[i+1];
+    auto it    = std::lower_bound(first, last, j);
+
+    return (it != last && *it == j) ? it - _base._cols.begin() : _base.nnz();
+}
+
+/** DATA ACCESS METHODS **/
+
+template <unsigned n, unsigned m>
+double DynamicCSRMatrix<n,m>::at(unsigned i, unsigned j) const
+{
+    check_bounds(i, j);
+
+    const unsigned k = find_base(i, j);
+    if (k != _base.nnz()) { return _base._vals[k]; } // Erased entries hold zero
+
+    const std::vector<Entry>& row = _delta[i];
+    auto it = std::lower_bound(row.begin(), row.end(), Entry(j, 0),
+              [](const Entry& a, const Entry& b) { return a.first < b.first; });
+
+    return (it != row.end() && it->first == j) ? it->second : 0;
+}
+
+template <unsigned n, unsigned m>
+bool DynamicCSRMatrix<n,m>::contains(unsigned i, unsigned j) const
+{
+    check_bounds(i, j);
+
+    const unsigned k = find_base(i, j);
+    if (k != _base.nnz()) { return !_erased[k]; }
+
+    return std::binary_search(_delta[i].begin(), _delta[i].end(), Entry(j, 0),
+           [](const Entry& a, const Entry& b) { return a.first < b.first; });
+}
+
+/** STRUCTURAL UPDATES **/
+
+template <unsigned n, unsigned m>
+void DynamicCSRMatrix<n,m>::set(unsigned i, unsigned j, double value)
+{
+    check_bounds(i, j);
+
+    const unsigned k = find_base(i, j);
+    if (k != _base.nnz())
+    {
+        if (_erased[k])
+        {
+            _erased[k] = false;
+            --_erased_count;
+        }
+        _base._vals[k] = value;
+        return;
+    }
+
+    std::vector<Entry>& row = _delta[i];
+    auto it = std::lower_bound(row.begin(), row.end(), Entry(j, 0),
+              [](const Entry& a, const Entry& b) { return a.first < b.first; });
+
+    if (it != row.end() && it->first == j)
+    {
+        it->second = value;
+        return;
+    }
+    row.insert(it, Entry(j, value));
+    _dirty[i] = true;
+    ++_inserted_count;
+
+    maybe_compact();
+}
+
+template <unsigned n, unsigned m>
+bool DynamicCSRMatrix<n,m>::erase(unsigned i, unsigned j)
+{
+    check_bounds(i, j);
+
+    const unsigned k = find_base(i, j);
+    if (k != _base.nnz())
+    {
+        if (_erased[k]) { return false; }
+
+        _base._vals[k] = 0;
+        _erased[k]     = true;
+        _dirty[i]      = true;
+        ++_erased_count;
+
+        maybe_compact();
+        return true;
+    }
+
+    std::vector<Entry>& row = _delta[i];
+    auto it = std::lower_bound(row.begin(), row.end(), Entry(j, 0),
+              [](const Entry& a, const Entry& b) { return a.first < b.first; });
+
+    if (it == row.end() || it->first != j) { return false; }
+
+    row.erase(it);
+    --_inserted_count;
+    return true;
+}
+
+template <unsigned n, unsigned m>
+void DynamicCSRMatrix<n,m>::maybe_compact()
+{
+    if (pending() > _compaction_ratio * std::max(_base.nnz(), static_cast<unsigned>(n)))
+    {
+        compact();
+    }
+}
+
+/** COMPACTION **/
+
+template <unsigned n, unsigned m>
+void DynamicCSRMatrix<n,m>::compact()
+{
+    if (pending() == 0) { return; }
+
+    _base = to_csr();
+
+    _erased.assign(_base.nnz(), false);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        if (_dirty[i])
+        {
+            _delta[i].clear();
+            _dirty[i] = false;
+        }
+    }
+    _erased_count   = 0;
+    _inserted_count = 0;
+}
+
+template <unsigned n, unsigned m>
+CSRMatrix<n,m> DynamicCSRMatrix<n,m>::to_csr() const
+{
+    CSRMatrix<n,m> A;
+    A._cols.resize(nnz());
+    A._vals.resize(nnz());
+
+    unsigned out = 0;
+    unsigned i   = 0;
+    while (i < n)
+    {
+        // Copy the run of clean rows [i, end) in one block
+        unsigned end = i;
+        while (end < n && !_dirty[end]) { ++end; }
+
+        const unsigned first = _base._row[i];
+        const unsigned last  = _base._row[end];
+        std::copy(_base._cols.begin() + first, _base._cols.begin() + last, A._cols.begin() + out);
+        std::copy(_base._vals.begin() + first, _base._vals.begin() + last, A._vals.begin() + out);
+        for (unsigned r = i; r < end; ++r)
+        {
+            A._row[r+1] = _base._row[r+1] - first + out;
+        }
+        out += last - first;
+
+        if (end == n) { break; }
+
+        // Merge the surviving base entries of a dirty row with its delta
+        unsigned k = _base._row[end];
+        auto     d = _delta[end].begin();
+        while (k < _base._row[end+1] || d != _delta[end].end())
+        {
+            if (k < _base._row[end+1] && _erased[k]) { ++k; continue; }
+
+            if (d == _delta[end].end() || (k < _base._row[end+1] && _base._cols[k] < d->first))
+            {
+                A._cols[out] = _base._cols[k];
+                A._vals[out] = _base._vals[k];
+                ++k;
+            }
+            else
+            {
+                A._cols[out] = d->first;
+                A._vals[out] = d->second;
+                ++d;
+            }
+            ++out;
+        }
+        A._row[end+1] = out;
+        i = end + 1;
+    }
+    return A;
+}
+
+template <unsigned n, unsigned m>
+FMatrix<n,m> DynamicCSRMatrix<n,m>::to_fmatrix() const
+{
+    FMatrix<n,m> A = _base.to_fmatrix();
+
+    for (unsigned i = 0; i < n; ++i)
+    {
+        for (const Entry& entry : _delta[i])
+        {
+            A[i][entry.first] = entry.second;
+        }
+    }
+    return A;
+}
+
+/** ARITHMETIC OPERATIONS **/
+
+template <unsigned n, unsigned m>
+template <unsigned p, typename V>
+FMatrix<n, p> DynamicCSRMatrix<n,m>::multiply(const MatrixView<m, p, V>& B) const
+{
+    FMatrix<n, p> C;
+
+    // Erased base entries hold zero and contribute nothing
+    detail::csr_multiply<n, m, p>(_base._row, _base._cols.data(), _base._vals.data(), B, C.view());
+
+    for (unsigned i = 0; i < n; ++i)
+    {
+        double* c = C[i];
+        for (const Entry& entry : _delta[i])
+        {
+            for (unsigned j = 0; j < p; ++j)
+            {
+                c[j] += entry.second * B.at_unsafe(entry.first, j);
+            }
+        }
+    }
+    return C;
+}
+
+#endif // DYNAMIC_CSR_MATRIX_CPP_H
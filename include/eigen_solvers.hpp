@@ -0,0 +1,767 @@
+/*
+
+File: eigen_solvers.hpp
+
+Brief: Iterative eigensolvers for sparse symmetric CSR matrices
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#ifndef EIGEN_SOLVERS_CPP_H
+#define EIGEN_SOLVERS_CPP_H
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+#include <numeric>
+#include <utility>
+#include <stdexcept>
+#include <algorithm>
+
+#include <fmatrix.hpp>
+#include <parallel.hpp>
+#include <csr_matrix.hpp>
+#include <reordering.hpp>
+
+enum class EigenTarget { Largest, Smallest };
+
+struct EigenOptions
+{
+    double      tolerance      = 1e-8;  // Relative residual ||Ax - lx|| / |l|
+    unsigned    max_iterations = 500;   // Lanczos: the largest Krylov basis
+    EigenTarget target         = EigenTarget::Largest;
+    unsigned    seed           = 5489;  // Seeds the random starting vectors
+    ThreadPool* pool           = nullptr; // Products run on the caller if null
+};
+
+template <unsigned n, unsigned k>
+struct EigenResult
+{
+    double       values[k] = {};
+    FMatrix<n,k> vectors;   // Column i belongs to values[i]
+
+    unsigned iterations = 0;
+    bool     converged  = false;
+};
+
+/*
+ * Scratch memory reused across solves, so repeated solves on matrices of the
+ * same size do not allocate the O(n) block vectors again.
+ */
+class EigenWorkspace
+{
+public:
+
+    double* reserve(std::size_t size)
+    {
+        if (_buffer.size() < size) { _buffer.resize(size); }
+        return _buffer.data();
+    }
+
+    std::vector<double> _buffer;
+};
+
+namespace detail
+{
+
+// C = A * B split across the pool by nonzeros
+template <unsigned n, unsigned m, unsigned p>
+void spmm(const CSRMatrix<n,m>& A, ConstFMatrixView<m, p> B, FMatrixView<n, p> C,
+          ThreadPool* pool, const std::vector<unsigned>& bounds)
+{
+    if (!pool)
+    {
+        csr_multiply<n, m, p>(A._row, A._cols.data(), A._vals.data(), B, C);
+        return;
+    }
+    MATRIX_CPP_KERNEL_SCOPE("CSRMatrix::multiply", n, p, m, 2.0 * A.nnz() * p,
+                            csr_multiply_bytes<n, m, p>(A.nnz()), A.nnz());
+
+    pool->run(bounds.size() - 1, [&](unsigned t)
+    {
+        csr_multiply_rows<n, m, p>(A._row, A._cols.data(), A._vals.data(), B, C,
+                                   bounds[t], bounds[t+1]);
+    });
+}
+
+inline double dot(const double* x, const double* y, unsigned size, unsigned stride = 1) noexcept
+{
+    double sum = 0;
+    for (unsigned i = 0; i < size; ++i) { sum += x[i * stride] * y[i * stride]; }
+    return sum;
+}
+
+// y -= a * x
+inline void axpy(double a, const double* x, double* y, unsigned size, unsigned stride = 1) noexcept
+{
+    for (unsigned i = 0; i < size; ++i) { y[i * stride] -= a * x[i * stride]; }
+}
+
+inline void randomize(double* x, unsigned size, unsigned stride, std::mt19937& rng)
+{
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    for (unsigned i = 0; i < size; ++i) { x[i * stride] = uniform(rng); }
+}
+
+// Sorts eigenvalues ascending and permutes the matching columns of Z
+inline void sort_eigenpairs(std::vector<double>& values, std::vector<double>& Z, unsigned rows)
+{
+    const unsigned r = values.size();
+
+    std::vector<unsigned> order(r);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](unsigned a, unsigned b) { return values[a] < values[b]; });
+
+    std::vector<double> sorted_values(r), sorted_Z(Z.size());
+    for (unsigned c = 0; c < r; ++c)
+    {
+        sorted_values[c] = values[order[c]];
+        for (unsigned i = 0; i < rows; ++i)
+        {
+            sorted_Z[(i * r) + c] = Z[(i * r) + order[c]];
+        }
+    }
+    values.swap(sorted_values);
+    Z.swap(sorted_Z);
+}
+
+/*
+ * Eigenvalues of the symmetric tridiagonal matrix with diagonal d and
+ * off-diagonal e (e[i] couples i and i + 1) by the implicit QL method.
+ * Z is a rows x r row-major matrix the rotations are applied to: pass the
+ * identity for full eigenvectors, or only its last row when just the bottom
+ * components are needed. Results are sorted ascending.
+ */
+inline void tridiagonal_eigen(std::vector<double>& d, std::vector<double> e,
+                              std::vector<double>& Z, unsigned rows)
+{
+    const int r = d.size();
+    e.resize(r, 0.0);
+    e[r-1] = 0.0;
+
+    for (int l = 0; l < r; ++l)
+    {
+        int iteration = 0;
+        int m;
+        do
+        {
+            for (m = l; m < r - 1; ++m)
+            {
+                const double dd = std::fabs(d[m]) + std::fabs(d[m+1]);
+                if (std::fabs(e[m]) <= std::numeric_limits<double>::epsilon() * dd) { break; }
+            }
+            if (m != l)
+            {
+                if (iteration++ == 60) { throw std::runtime_error("Tridiagonal QL failed to converge"); }
+
+                double g  = (d[l+1] - d[l]) / (2.0 * e[l]);
+                double rr = std::hypot(g, 1.0);
+                g = d[m] - d[l] + e[l] / (g + std::copysign(rr, g));
+
+                double s = 1.0, c = 1.0, p = 0.0;
+                int i;
+                for (i = m - 1; i >= l; --i)
+                {
+                    double f = s * e[i];
+                    double b = c * e[i];
+                    e[i+1] = (rr = std::hypot(f, g));
+                    if (rr == 0.0)
+                    {
+                        d[i+1] -= p;
+                        e[m] = 0.0;
+                        break;
+                    }
+                    s = f / rr;
+                    c = g / rr;
+                    g = d[i+1] - p;
+                    rr = (d[i] - g) * s + 2.0 * c * b;
+                    d[i+1] = g + (p = s * rr);
+                    g = c * rr - b;
+
+                    for (unsigned z = 0; z < rows; ++z)
+                    {
+                        double* row = &Z[z * r];
+                        f = row[i+1];
+                        row[i+1] = s * row[i] + c * f;
+                        row[i]   = c * row[i] - s * f;
+                    }
+                }
+                if (rr == 0.0 && i >= l) { continue; }
+
+                d[l] -= p;
+                e[l] = g;
+                e[m] = 0.0;
+            }
+        } while (m != l);
+    }
+    sort_eigenpairs(d, Z, rows);
+}
+
+/*
+ * Eigenvector of the symmetric tridiagonal matrix (d, e) belonging to the
+ * eigenvalue theta, by inverse iteration. T - theta I is factored once with
+ * partial pivoting, so each pass costs O(r) instead of the O(r^2) per vector
+ * of accumulating the QL rotations. The result has unit length.
+ */
+inline std::vector<double> tridiagonal_eigenvector(const std::vector<double>& d,
+                                                   const std::vector<double>& e, double theta)
+{
+    const unsigned r = d.size();
+
+    double norm = 0;
+    for (unsigned i = 0; i < r; ++i)
+    {
+        norm = std::max(norm, std::fabs(d[i]) + (i > 0 ? std::fabs(e[i-1]) : 0.0)
+                                              + (i + 1 < r ? std::fabs(e[i]) : 0.0));
+    }
+    const double tiny = std::numeric_limits<double>::epsilon() * std::max(norm, 1e-300);
+
+    // U holds up to three entries per row, L one multiplier per row
+    std::vector<double> u0(r), u1(r, 0.0), u2(r, 0.0), l(r, 0.0);
+    std::vector<bool>   swapped(r, false);
+
+    double diag = d[0] - theta;
+    double up   = r > 1 ? e[0] : 0.0;
+    for (unsigned i = 0; i + 1 < r; ++i)
+    {
+        const double below = e[i];
+        const double next  = d[i+1] - theta;
+        const double far   = i + 2 < r ? e[i+1] : 0.0;
+        if (std::fabs(diag) >= std::fabs(below))
+        {
+            l[i]  = diag == 0.0 ? 0.0 : below / diag;
+            u0[i] = diag;
+            u1[i] = up;
+            diag  = next - (l[i] * up);
+            up    = far;
+        }
+        else
+        {
+            l[i]       = diag / below;
+            swapped[i] = true;
+            u0[i] = below;
+            u1[i] = next;
+            u2[i] = far;
+            diag  = up - (l[i] * next);
+            up    = -l[i] * far;
+        }
+        if (std::fabs(u0[i]) < tiny) { u0[i] = std::copysign(tiny, u0[i]); }
+    }
+    u0[r-1] = std::fabs(diag) < tiny ? std::copysign(tiny, diag) : diag;
+
+    std::vector<double> x(r, 1.0);
+    for (unsigned pass = 0; pass < 3; ++pass)
+    {
+        for (unsigned i = 0; i + 1 < r; ++i)
+        {
+            if (swapped[i]) { std::swap(x[i], x[i+1]); }
+            x[i+1] -= l[i] * x[i];
+        }
+        for (unsigned i = r; i-- > 0; )
+        {
+            double sum = x[i];
+            if (i + 1 < r) { sum -= u1[i] * x[i+1]; }
+            if (i + 2 < r) { sum -= u2[i] * x[i+2]; }
+            x[i] = sum / u0[i];
+        }
+        const double length = std::sqrt(dot(x.data(), x.data(), r));
+        for (double& v : x) { v /= length; }
+    }
+    return x;
+}
+
+/*
+ * Eigenpairs of a small dense symmetric r x r row-major matrix by cyclic
+ * Jacobi rotations. Eigenvectors are the columns of V, sorted ascending.
+ */
+inline void symmetric_eigen(std::vector<double> H, unsigned r,
+                            std::vector<double>& values, std::vector<double>& V)
+{
+    V.assign(r * r, 0.0);
+    for (unsigned i = 0; i < r; ++i) { V[(i * r) + i] = 1.0; }
+
+    const double norm = std::sqrt(dot(H.data(), H.data(), r * r));
+
+    for (unsigned sweep = 0; sweep < 100; ++sweep)
+    {
+        double off = 0;
+        for (unsigned p = 0; p < r; ++p)
+        {
+            for (unsigned q = p + 1; q < r; ++q) { off += H[(p * r) + q] * H[(p * r) + q]; }
+        }
+        if (std::sqrt(off) <= std::numeric_limits<double>::epsilon() * norm) { break; }
+
+        for (unsigned p = 0; p < r; ++p)
+        {
+            for (unsigned q = p + 1; q < r; ++q)
+            {
+                const double apq = H[(p * r) + q];
+                if (apq == 0.0) { continue; }
+
+                const double theta = (H[(q * r) + q] - H[(p * r) + p]) / (2.0 * apq);
+                const double t = std::copysign(1.0, theta) / (std::fabs(theta) + std::hypot(theta, 1.0));
+                const double c = 1.0 / std::hypot(t, 1.0);
+                const double s = t * c;
+
+                for (unsigned i = 0; i < r; ++i)
+                {
+                    const double hp = H[(i * r) + p], hq = H[(i * r) + q];
+                    H[(i * r) + p] = c * hp - s * hq;
+                    H[(i * r) + q] = s * hp + c * hq;
+                }
+                for (unsigned i = 0; i < r; ++i)
+                {
+                    const double hp = H[(p * r) + i], hq = H[(q * r) + i];
+                    H[(p * r) + i] = c * hp - s * hq;
+                    H[(q * r) + i] = s * hp + c * hq;
+                }
+                for (unsigned i = 0; i < r; ++i)
+                {
+                    const double vp = V[(i * r) + p], vq = V[(i * r) + q];
+                    V[(i * r) + p] = c * vp - s * vq;
+                    V[(i * r) + q] = s * vp + c * vq;
+                }
+            }
+        }
+    }
+
+    values.resize(r);
+    for (unsigned i = 0; i < r; ++i) { values[i] = H[(i * r) + i]; }
+    sort_eigenpairs(values, V, r);
+}
+
+// Index of the c-th wanted eigenvalue among r sorted ascending
+inline unsigned wanted(unsigned c, unsigned r, EigenTarget target) noexcept
+{
+    return (target == EigenTarget::Largest) ? r - 1 - c : c;
+}
+
+} // namespace detail
+
+/*
+ * Power iteration for the eigenvalue of largest magnitude. Converges at the
+ * rate |l2 / l1|, so it suits matrices with a clear spectral gap such as
+ * PageRank-style transition matrices.
+ */
+template <unsigned n>
+EigenResult<n,1> power_iteration(const CSRMatrix<n,n>& A, const EigenOptions& options,
+                                 EigenWorkspace& workspace)
+{
+    EigenResult<n,1> result;
+
+    double* x = workspace.reserve(2 * n);
+    double* y = x + n;
+
+    const std::vector<unsigned> bounds = nnz_partition(A, options.pool ? options.pool->size() : 1);
+
+    std::mt19937 rng(options.seed);
+    detail::randomize(x, n, 1, rng);
+
+    double norm = std::sqrt(detail::dot(x, x, n));
+    for (unsigned i = 0; i < n; ++i) { x[i] /= norm; }
+
+    double lambda = 0;
+    for (result.iterations = 1; result.iterations <= options.max_iterations; ++result.iterations)
+    {
+        detail::spmm<n, n, 1>(A, ConstFMatrixView<n,1>(x, 1), FMatrixView<n,1>(y, 1),
+                              options.pool, bounds);
+
+        lambda = detail::dot(x, y, n);
+
+        double residual = 0;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            residual += (y[i] - lambda * x[i]) * (y[i] - lambda * x[i]);
+        }
+
+        norm = std::sqrt(detail::dot(y, y, n));
+        if (norm == 0) { break; } // x is in the null space
+
+        result.converged = std::sqrt(residual) <= options.tolerance * std::fabs(lambda);
+        if (result.converged) { break; }
+
+        for (unsigned i = 0; i < n; ++i) { x[i] = y[i] / norm; }
+    }
+    result.iterations = std::min(result.iterations, options.max_iterations);
+
+    result.values[0] = lambda;
+    for (unsigned i = 0; i < n; ++i) { result.vectors[i][0] = x[i]; }
+    return result;
+}
+
+/*
+ * Lanczos iteration for k extreme eigenpairs of a symmetric matrix. The
+ * Krylov basis grows one vector per step, up to max_iterations vectors, with
+ * no restarts. Orthogonality is lost in finite precision exactly along Ritz
+ * vectors that have converged, so each such vector is formed once when its
+ * error bound drops below sqrt(eps) and every later Lanczos vector is purged
+ * of it (Parlett-Scott selective orthogonalization). Ritz values are analyzed
+ * every step early on and at a spacing proportional to the basis size later,
+ * keeping the O(j^2) analysis cheap next to the products.
+ *
+ * A Krylov space holds one copy of each eigenvalue it reaches, so when it
+ * becomes invariant, iteration restarts from a fresh orthogonal direction
+ * to look for further copies. It stops once a restarted block converges
+ * without displacing any of the k wanted values found before it.
+ */
+template <unsigned k, unsigned n>
+EigenResult<n,k> lanczos(const CSRMatrix<n,n>& A, const EigenOptions& options,
+                         EigenWorkspace& workspace)
+{
+    static_assert(k > 0 && k <= n, "Lanczos needs 0 < k <= n");
+
+    EigenResult<n,k> result;
+
+    const unsigned steps = std::max(k, std::min(options.max_iterations, n));
+
+    double* Q = workspace.reserve((steps + 2) * static_cast<std::size_t>(n));
+    double* w = Q + (steps + 1) * static_cast<std::size_t>(n);
+    auto q = [Q](unsigned j) { return Q + static_cast<std::size_t>(j) * n; };
+
+    const std::vector<unsigned> bounds = nnz_partition(A, options.pool ? options.pool->size() : 1);
+    const double eps = std::numeric_limits<double>::epsilon();
+
+    std::mt19937 rng(options.seed);
+    detail::randomize(q(0), n, 1, rng);
+    double norm = std::sqrt(detail::dot(q(0), q(0), n));
+    for (unsigned i = 0; i < n; ++i) { q(0)[i] /= norm; }
+
+    std::vector<double> alpha, beta;
+    std::vector<double> theta, Z;
+
+    // Converged Ritz values and their Ritz vectors, n doubles each
+    std::vector<double> good_theta, good_vectors;
+
+    std::vector<unsigned> starts { 0 }; // First Lanczos vector of each Krylov block
+    double t_bound = 0;
+
+    for (unsigned j = 0; j < steps; ++j)
+    {
+        result.iterations = j + 1;
+
+        detail::spmm<n, n, 1>(A, ConstFMatrixView<n,1>(q(j), 1), FMatrixView<n,1>(w, 1),
+                              options.pool, bounds);
+        if (j > 0) { detail::axpy(beta[j-1], q(j-1), w, n); }
+
+        alpha.push_back(detail::dot(q(j), w, n));
+        detail::axpy(alpha[j], q(j), w, n);
+
+        for (unsigned g = 0; g < good_theta.size(); ++g)
+        {
+            const double* y = &good_vectors[g * static_cast<std::size_t>(n)];
+            detail::axpy(detail::dot(y, w, n), y, w, n);
+        }
+        double b = std::sqrt(detail::dot(w, w, n));
+
+        // Gershgorin bound on ||T||, tracked so that the invariance test is
+        // scaled correctly on steps that skip the analysis
+        t_bound = std::max(t_bound, std::fabs(alpha[j]) + b + (j > 0 ? beta[j-1] : 0.0));
+
+        const unsigned size     = j + 1;
+        const bool     last     = j + 1 == steps;
+        const bool     dwindled = b <= std::sqrt(eps) * t_bound;
+        const bool     analyze  = last || dwindled || size < 32 || size % (size / 32) == 0;
+
+        bool converged = false;
+        bool improves  = true; // Whether the current block adds to the wanted set
+        double t_norm  = std::fabs(alpha[j]);
+        if (analyze)
+        {
+            // Ritz values and the bottom row of the Ritz vectors of T_j
+            theta = alpha;
+            Z.assign(size, 0.0);
+            Z[size - 1] = 1.0;
+            detail::tridiagonal_eigen(theta, beta, Z, 1);
+
+            t_norm = std::max(std::fabs(theta.front()), std::fabs(theta.back()));
+
+            std::vector<unsigned> fresh;
+            for (unsigned i = 0; i < size; ++i)
+            {
+                const bool known = std::any_of(good_theta.begin(), good_theta.end(),
+                                   [&](double g) { return std::fabs(g - theta[i]) <= std::sqrt(eps) * t_norm; });
+
+                if (!known && b * std::fabs(Z[i]) <= std::sqrt(eps) * t_norm) { fresh.push_back(i); }
+            }
+            if (!fresh.empty() && b > eps * t_norm)
+            {
+                for (unsigned i : fresh)
+                {
+                    const std::vector<double> z = detail::tridiagonal_eigenvector(alpha, beta, theta[i]);
+
+                    std::vector<double> y(n, 0.0);
+                    for (unsigned r = 0; r < size; ++r) { detail::axpy(-z[r], q(r), y.data(), n); }
+                    detail::axpy(detail::dot(y.data(), w, n), y.data(), w, n);
+
+                    good_theta.push_back(theta[i]);
+                    good_vectors.insert(good_vectors.end(), y.begin(), y.end());
+                }
+                b = std::sqrt(detail::dot(w, w, n));
+            }
+
+            converged = size >= k;
+            for (unsigned c = 0; converged && c < k; ++c)
+            {
+                const unsigned i = detail::wanted(c, size, options.target);
+                converged = b * std::fabs(Z[i]) <= options.tolerance * std::max(std::fabs(theta[i]), eps);
+            }
+
+            const unsigned start = starts.back();
+            if (start > 0)
+            {
+                // The earlier blocks are exact and always pass the residual
+                // test, so the extreme Ritz value of this block must as well
+                std::vector<double> block(alpha.begin() + start, alpha.end());
+                std::vector<double> block_z(size - start, 0.0);
+                block_z.back() = 1.0;
+                detail::tridiagonal_eigen(block, std::vector<double>(beta.begin() + start, beta.end()),
+                                          block_z, 1);
+
+                const unsigned i = detail::wanted(0, size - start, options.target);
+                converged = converged &&
+                            b * std::fabs(block_z[i]) <= options.tolerance * std::max(std::fabs(block[i]), eps);
+
+                // Another copy may remain only if this block's extreme value
+                // displaced one of the k wanted values of the earlier blocks
+                std::vector<double> earlier(alpha.begin(), alpha.begin() + start), unused(start, 0.0);
+                detail::tridiagonal_eigen(earlier, std::vector<double>(beta.begin(), beta.begin() + start - 1),
+                                          unused, 1);
+                if (start >= k)
+                {
+                    const double kth    = earlier[detail::wanted(k - 1, start, options.target)];
+                    const double margin = std::sqrt(eps) * t_bound;
+                    improves = (options.target == EigenTarget::Largest) ? block[i] > kth + margin
+                                                                        : block[i] < kth - margin;
+                }
+            }
+        }
+
+        // A block is invariant once b is at the level of the rounding and
+        // orthogonality errors. It has then found one copy of each eigenvalue
+        // it reaches, so the search restarts for further copies unless the
+        // block added nothing to the wanted set or the basis spans the space.
+        const bool invariant = b <= std::sqrt(eps) * t_bound;
+        const bool exhausted = invariant && size == n;
+        if (invariant && !exhausted && improves) { converged = false; }
+
+        if (converged || exhausted || last)
+        {
+            result.converged = converged || exhausted;
+            break;
+        }
+
+        if (invariant)
+        {
+            // Krylov space exhausted, continue from a fresh direction
+            // orthogonal to the basis so far
+            detail::randomize(w, n, 1, rng);
+            for (unsigned pass = 0; pass < 2; ++pass)
+            {
+                for (unsigned i = 0; i < size; ++i) { detail::axpy(detail::dot(q(i), w, n), q(i), w, n); }
+            }
+            beta.push_back(0.0);
+            norm = std::sqrt(detail::dot(w, w, n));
+            starts.push_back(size);
+        }
+        else
+        {
+            beta.push_back(b);
+            norm = b;
+        }
+        for (unsigned i = 0; i < n; ++i) { q(j+1)[i] = w[i] / norm; }
+    }
+
+    // Ritz pairs of the final tridiagonal matrix. It is block diagonal with
+    // one block per Krylov restart, and a repeated eigenvalue shows up once in
+    // several blocks, so each Ritz vector is formed from its own block.
+    const unsigned size = alpha.size();
+    beta.resize(size - 1);
+    starts.push_back(size);
+
+    std::vector<std::pair<double, unsigned>> ritz; // Value and its block
+    for (unsigned blk = 0; blk + 1 < starts.size(); ++blk)
+    {
+        std::vector<double> values(alpha.begin() + starts[blk], alpha.begin() + starts[blk+1]);
+        std::vector<double> bottom(values.size(), 0.0);
+        detail::tridiagonal_eigen(values, std::vector<double>(beta.begin() + starts[blk],
+                                                              beta.begin() + starts[blk+1] - 1),
+                                  bottom, 1);
+
+        for (double value : values) { ritz.emplace_back(value, blk); }
+    }
+    std::sort(ritz.begin(), ritz.end());
+
+    for (unsigned c = 0; c < k && c < size; ++c)
+    {
+        const unsigned i     = detail::wanted(c, size, options.target);
+        const unsigned first = starts[ritz[i].second];
+        const unsigned last  = starts[ritz[i].second + 1];
+
+        const std::vector<double> z = detail::tridiagonal_eigenvector(
+            std::vector<double>(alpha.begin() + first, alpha.begin() + last),
+            std::vector<double>(beta.begin() + first, beta.begin() + last - 1), ritz[i].first);
+
+        result.values[c] = ritz[i].first;
+        for (unsigned j = first; j < last; ++j)
+        {
+            for (unsigned r = 0; r < n; ++r) { result.vectors[r][c] += z[j - first] * q(j)[r]; }
+        }
+    }
+    return result;
+}
+
+/*
+ * Locally Optimal Block Preconditioned Conjugate Gradient for k extreme
+ * eigenpairs. Each iteration applies A to the whole residual and search
+ * direction blocks with one SpMM, then performs Rayleigh-Ritz on the basis
+ * [X W P]. Basis columns that become linearly dependent are dropped.
+ */
+template <unsigned k, unsigned n>
+EigenResult<n,k> lobpcg(const CSRMatrix<n,n>& A, const EigenOptions& options,
+                        EigenWorkspace& workspace)
+{
+    static_assert(k > 0 && k <= n, "LOBPCG needs 0 < k <= n");
+
+    constexpr unsigned s = 3 * k; // Basis columns [X W P]
+
+    EigenResult<n,k> result;
+
+    // Row-major n x s blocks: the basis S, its image AS = A S, and scratch
+    double* S  = workspace.reserve(3 * static_cast<std::size_t>(n) * s);
+    double* AS = S  + static_cast<std::size_t>(n) * s;
+    double* T  = AS + static_cast<std::size_t>(n) * s;
+    std::fill(S, S + 3 * static_cast<std::size_t>(n) * s, 0.0);
+
+    FMatrixView<n, s> basis(S, s), image(AS, s), scratch(T, s);
+
+    const std::vector<unsigned> bounds = nnz_partition(A, options.pool ? options.pool->size() : 1);
+
+    bool active[s] = {};
+    double lambda[k] = {};
+
+    // Gram-Schmidt of column c against the active columns before it, twice
+    auto orthonormalize = [&](unsigned c)
+    {
+        const double before = std::sqrt(detail::dot(S + c, S + c, n, s));
+        for (unsigned pass = 0; pass < 2; ++pass)
+        {
+            for (unsigned j = 0; j < c; ++j)
+            {
+                if (active[j]) { detail::axpy(detail::dot(S + j, S + c, n, s), S + j, S + c, n, s); }
+            }
+        }
+        const double after = std::sqrt(detail::dot(S + c, S + c, n, s));
+
+        active[c] = before > 0 && after > 1e-10 * before;
+        for (unsigned i = 0; i < n; ++i) { S[(i * s) + c] = active[c] ? S[(i * s) + c] / after : 0.0; }
+    };
+
+    std::mt19937 rng(options.seed);
+    for (unsigned c = 0; c < k; ++c)
+    {
+        detail::randomize(S + c, n, s, rng);
+        orthonormalize(c);
+    }
+    detail::spmm<n, n, k>(A, basis.template submatrix<n, k>(0, 0),
+                          image.template submatrix<n, k>(0, 0), options.pool, bounds);
+
+    for (result.iterations = 1; result.iterations <= options.max_iterations; ++result.iterations)
+    {
+        // Rayleigh-Ritz on the active basis columns
+        std::vector<unsigned> index;
+        for (unsigned c = 0; c < s; ++c) { if (active[c]) { index.push_back(c); } }
+        const unsigned r = index.size();
+
+        std::vector<double> H(r * r), values, V;
+        for (unsigned a = 0; a < r; ++a)
+        {
+            for (unsigned b = a; b < r; ++b)
+            {
+                const double h = 0.5 * (detail::dot(S + index[a], AS + index[b], n, s)
+                                      + detail::dot(S + index[b], AS + index[a], n, s));
+                H[(a * r) + b] = H[(b * r) + a] = h;
+            }
+        }
+        detail::symmetric_eigen(H, r, values, V);
+
+        // X = S C, AX = AS C and P = the part of S C outside the old X block
+        scratch.mult_into(0.0);
+        for (unsigned c = 0; c < k; ++c)
+        {
+            const unsigned e = detail::wanted(c, r, options.target);
+            lambda[c] = values[e];
+            for (unsigned a = 0; a < r; ++a)
+            {
+                const double v = V[(a * r) + e];
+                detail::axpy(-v, S  + index[a], T + c,     n, s);
+                detail::axpy(-v, AS + index[a], T + k + c, n, s);
+                if (index[a] >= k) { detail::axpy(-v, S + index[a], T + 2 * k + c, n, s); }
+            }
+        }
+        basis.template submatrix<n, k>(0, 0).assign(scratch.template submatrix<n, k>(0, 0));
+        image.template submatrix<n, k>(0, 0).assign(scratch.template submatrix<n, k>(0, k));
+        basis.template submatrix<n, k>(0, 2 * k).assign(scratch.template submatrix<n, k>(0, 2 * k));
+
+        // Residuals W = AX - X diag(lambda)
+        result.converged = true;
+        for (unsigned c = 0; c < k; ++c)
+        {
+            double residual = 0;
+            for (unsigned i = 0; i < n; ++i)
+            {
+                const double w = AS[(i * s) + c] - lambda[c] * S[(i * s) + c];
+                S[(i * s) + k + c] = w;
+                residual += w * w;
+            }
+            result.converged = result.converged && std::sqrt(residual)
+                <= options.tolerance * std::max(std::fabs(lambda[c]), std::numeric_limits<double>::epsilon());
+        }
+        if (result.converged) { break; }
+
+        const bool first = result.iterations == 1;
+        for (unsigned c = k; c < s; ++c)
+        {
+            active[c] = true;
+            if (first && c >= 2 * k) { active[c] = false; continue; }
+            orthonormalize(c);
+        }
+
+        detail::spmm<n, n, 2 * k>(A, basis.template submatrix<n, 2 * k>(0, k),
+                                  image.template submatrix<n, 2 * k>(0, k), options.pool, bounds);
+    }
+    result.iterations = std::min(result.iterations, options.max_iterations);
+
+    for (unsigned c = 0; c < k; ++c)
+    {
+        result.values[c] = lambda[c];
+        for (unsigned i = 0; i < n; ++i) { result.vectors[i][c] = S[(i * s) + c]; }
+    }
+    return result;
+}
+
+template <unsigned n>
+EigenResult<n,1> power_iteration(const CSRMatrix<n,n>& A, const EigenOptions& options = {})
+{
+    EigenWorkspace workspace;
+    return power_iteration(A, options, workspace);
+}
+
+template <unsigned k, unsigned n>
+EigenResult<n,k> lanczos(const CSRMatrix<n,n>& A, const EigenOptions& options = {})
+{
+    EigenWorkspace workspace;
+    return lanczos<k>(A, options, workspace);
+}
+
+template <unsigned k, unsigned n>
+EigenResult<n,k> lobpcg(const CSRMatrix<n,n>& A, const EigenOptions& options = {})
+{
+    EigenWorkspace workspace;
+    return lobpcg<k>(A, options, workspace);
+}
+
+#endif // EIGEN_SOLVERS_CPP_H
@@ -16,6 +16,9 @@ https://github.com/AlexanderJDupree/matrix-cpp
 #include <stdexcept>
 #include <algorithm>
 
+#include <fmatrix_view.hpp>
+#include <kernel_scope.hpp>
+
 template <unsigned n, unsigned m>
 class FMatrix
 {
@@ -47,6 +50,21 @@ public:
     double& operator()(unsigned i, unsigned j)             { return at(i, j); }
     const double& operator()(unsigned i, unsigned j) const { return at(i, j); }
 
+    /* Views */
+    FMatrixView<n, m>      view() noexcept       { return FMatrixView<n, m>(_fmat, m); }
+    ConstFMatrixView<n, m> view() const noexcept { return ConstFMatrixView<n, m>(_fmat, m); }
+
+    template <unsigned r, unsigned c>
+    FMatrixView<r, c>      submatrix(unsigned i, unsigned j)       { return view().template submatrix<r, c>(i, j); }
+    template <unsigned r, unsigned c>
+    ConstFMatrixView<r, c> submatrix(unsigned i, unsigned j) const { return view().template submatrix<r, c>(i, j); }
+
+    FMatrixView<1, m>      row(unsigned i)       { return view().row(i); }
+    ConstFMatrixView<1, m> row(unsigned i) const { return view().row(i); }
+
+    FMatrixView<n, 1>      column(unsigned j)       { return view().column(j); }
+    ConstFMatrixView<n, 1> column(unsigned j) const { return view().column(j); }
+
     /* Arithmetic Operations */
     FMatrix<n, m> add        (const FMatrix<n, m>& rhs) const;
     FMatrix<n, m> operator + (const FMatrix<n, m>& rhs) const;
@@ -54,6 +72,16 @@ public:
     FMatrix<n, m>& add_into    (const FMatrix<n, m>& rhs);
     FMatrix<n, m>& operator += (const FMatrix<n, m>& rhs);
 
+    template <typename V>
+    FMatrix<n, m> add        (const MatrixView<n, m, V>& rhs) const { return view().add(rhs); }
+    template <typename V>
+    FMatrix<n, m> operator + (const MatrixView<n, m, V>& rhs) const { return add(rhs); }
+
+    template <typename V>
+    FMatrix<n, m>& add_into    (const MatrixView<n, m, V>& rhs) { view().add_into(rhs); return *this; }
+    template <typename V>
+    FMatrix<n, m>& operator += (const MatrixView<n, m, V>& rhs) { return add_into(rhs); }
+
     FMatrix<n, m>& mult_into (const double& scalar);
     FMatrix<n, m>& operator*=(const double& scalar);
 
@@ -67,6 +95,11 @@ public:
     template <unsigned p>
     FMatrix<n, p> operator* (const FMatrix<m, p>& rhs) const;
 
+    template <unsigned p, typename V>
+    FMatrix<n, p> multiply (const MatrixView<m, p, V>& rhs) const { return view().multiply(rhs); }
+    template <unsigned p, typename V>
+    FMatrix<n, p> operator* (const MatrixView<m, p, V>& rhs) const { return multiply(rhs); }
+
     /* Comparison Operations */
     bool operator == (const FMatrix<n, m>& rhs) const noexcept;
     bool operator != (const FMatrix<n, m>& rhs) const noexcept;
@@ -191,18 +224,7 @@ FMatrix<n, p> FMatrix<n,m>::multiply (const FMatrix<m, p>& B) const
 {
     FMatrix<n,p> C;
 
-    for (unsigned i = 0; i < n; ++i)
-    {
-        for (unsigned j = 0; j < p; ++j)
-        {
-            double sum = 0;
-            for (unsigned k = 0; k < m; ++k)
-            {
-                sum += (*this)[i][k] * B[k][j];
-            }
-            C[i][j] = sum;
-        }
-    }
+    detail::dense_multiply<n, m, p>(view(), B.view(), C.view());
     return C;
 }
 
@@ -234,6 +256,7 @@ bool FMatrix<n,m>::operator!=(const FMatrix<n,m>& rhs) const noexcept
 template <unsigned n, unsigned m>
 FMatrix<m, n> FMatrix<n,m> ::transpose() const
 {
+    MATRIX_CPP_KERNEL_SCOPE("FMatrix::transpose", m, n, 0, 0, 2.0 * sizeof(double) * n * m);
     FMatrix<m,n> T;
 
     for (unsigned i = 0; i < n; ++i)
@@ -0,0 +1,341 @@
+/*
+
+File: fmatrix_view.hpp
+
+Brief: Non-owning strided views into flat matrix storage
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#ifndef FLAT_MATRIX_VIEW_CPP_H
+#define FLAT_MATRIX_VIEW_CPP_H
+
+#include <stdexcept>
+#include <algorithm>
+#include <type_traits>
+
+#include <kernel_scope.hpp>
+
+template <unsigned n, unsigned m>
+class FMatrix;
+
+/*
+ * An n x m window onto doubles owned elsewhere. Element (i, j) lives at
+ * _data[i * _row_stride + j * _col_stride], so row ranges, blocks, single
+ * columns and transposes are all views with different strides. Views are
+ * shallow like pointers: copying a view never copies elements, and the
+ * const-ness of the element type, not of the view, controls mutation.
+ */
+template <unsigned n, unsigned m, typename Value>
+class MatrixView
+{
+public:
+
+    MatrixView(Value* data, unsigned row_stride, unsigned col_stride = 1) noexcept
+        : _data(data), _row_stride(row_stride), _col_stride(col_stride) {}
+
+    // Mutable views convert to read-only views
+    template <typename Other,
+              typename = std::enable_if_t<std::is_same_v<Value, const Other>>>
+    MatrixView(const MatrixView<n, m, Other>& other) noexcept
+        : _data(other._data), _row_stride(other._row_stride), _col_stride(other._col_stride) {}
+
+    /* Data Access Methods */
+    Value& at(unsigned i, unsigned j) const;
+    Value& at_unsafe(unsigned i, unsigned j) const noexcept
+    {
+        return _data[(i * _row_stride) + (j * _col_stride)];
+    }
+
+    Value& operator()(unsigned i, unsigned j) const { return at(i, j); }
+
+    bool is_contiguous() const noexcept { return _col_stride == 1 && _row_stride == m; }
+
+    FMatrix<n, m> to_fmatrix() const;
+
+    /* Slicing */
+    template <unsigned r, unsigned c>
+    MatrixView<r, c, Value> submatrix(unsigned i, unsigned j) const;
+    template <unsigned r>
+    MatrixView<r, m, Value> rows(unsigned i) const { return submatrix<r, m>(i, 0); }
+
+    MatrixView<1, m, Value> row   (unsigned i) const { return submatrix<1, m>(i, 0); }
+    MatrixView<n, 1, Value> column(unsigned j) const { return submatrix<n, 1>(0, j); }
+
+    /* Transformations */
+    MatrixView<m, n, Value> transpose() const noexcept
+    {
+        return MatrixView<m, n, Value>(_data, _col_stride, _row_stride);
+    }
+
+    /* Arithmetic Operations */
+    template <typename V>
+    FMatrix<n, m> add        (const MatrixView<n, m, V>& rhs) const;
+    template <typename V>
+    FMatrix<n, m> operator + (const MatrixView<n, m, V>& rhs) const { return add(rhs); }
+
+    FMatrix<n, m> add        (const FMatrix<n, m>& rhs) const;
+    FMatrix<n, m> operator + (const FMatrix<n, m>& rhs) const { return add(rhs); }
+
+    template <typename V>
+    MatrixView& add_into    (const MatrixView<n, m, V>& rhs);
+    template <typename V>
+    MatrixView& operator += (const MatrixView<n, m, V>& rhs) { return add_into(rhs); }
+
+    MatrixView& add_into    (const FMatrix<n, m>& rhs);
+    MatrixView& operator += (const FMatrix<n, m>& rhs) { return add_into(rhs); }
+
+    template <typename V>
+    MatrixView& assign(const MatrixView<n, m, V>& rhs);
+    MatrixView& assign(const FMatrix<n, m>& rhs);
+
+    MatrixView& mult_into (const double& scalar);
+    MatrixView& operator*=(const double& scalar) { return mult_into(scalar); }
+
+    FMatrix<n, m> multiply (const double& scalar) const;
+    FMatrix<n, m> operator*(const double& scalar) const { return multiply(scalar); }
+
+    template <unsigned p, typename V>
+    FMatrix<n, p> multiply (const MatrixView<m, p, V>& rhs) const;
+    template <unsigned p, typename V>
+    FMatrix<n, p> operator* (const MatrixView<m, p, V>& rhs) const { return multiply(rhs); }
+
+    template <unsigned p>
+    FMatrix<n, p> multiply (const FMatrix<m, p>& rhs) const;
+    template <unsigned p>
+    FMatrix<n, p> operator* (const FMatrix<m, p>& rhs) const { return multiply(rhs); }
+
+    /* Comparison Operations */
+    template <typename V>
+    bool operator == (const MatrixView<n, m, V>& rhs) const noexcept;
+    template <typename V>
+    bool operator != (const MatrixView<n, m, V>& rhs) const noexcept { return !(*this == rhs); }
+
+    bool operator == (const FMatrix<n, m>& rhs) const noexcept;
+    bool operator != (const FMatrix<n, m>& rhs) const noexcept { return !(*this == rhs); }
+
+    Value*   _data;
+    unsigned _row_stride;
+    unsigned _col_stride;
+};
+
+template <unsigned n, unsigned m>
+using FMatrixView = MatrixView<n, m, double>;
+
+template <unsigned n, unsigned m>
+using ConstFMatrixView = MatrixView<n, m, const double>;
+
+namespace detail
+{
+
+// C = A * B, or C += A * B when accumulating. C must not overlap A or B.
+// Matrices, views and mapped matrices all multiply through here.
+template <unsigned n, unsigned m, unsigned p>
+void dense_multiply(ConstFMatrixView<n, m> A, ConstFMatrixView<m, p> B,
+                    FMatrixView<n, p> C, bool accumulate = false)
+{
+    MATRIX_CPP_KERNEL_SCOPE("FMatrix::multiply", n, p, m, 2.0 * n * m * p,
+                            sizeof(double) * ((double(n) * m) + (double(m) * p) + (double(n) * p)));
+
+    const bool unit_stride = B._col_stride == 1 && C._col_stride == 1;
+
+    for (unsigned i = 0; i < n; ++i)
+    {
+        double* c = &C.at_unsafe(i, 0);
+        if (!accumulate)
+        {
+            for (unsigned j = 0; j < p; ++j) { c[j * C._col_stride] = 0; }
+        }
+        for (unsigned k = 0; k < m; ++k)
+        {
+            const double  a = A.at_unsafe(i, k);
+            const double* b = &B.at_unsafe(k, 0);
+            if (unit_stride)
+            {
+                for (unsigned j = 0; j < p; ++j) { c[j] += a * b[j]; }
+            }
+            else
+            {
+                for (unsigned j = 0; j < p; ++j)
+                {
+                    c[j * C._col_stride] += a * b[j * B._col_stride];
+                }
+            }
+        }
+    }
+}
+
+} // namespace detail
+
+/* C = A * B written directly into the storage viewed by C */
+template <unsigned n, unsigned m, unsigned p, typename VA, typename VB>
+void multiply_into(FMatrixView<n, p> C, const MatrixView<n, m, VA>& A, const MatrixView<m, p, VB>& B)
+{
+    detail::dense_multiply<n, m, p>(A, B, C);
+}
+
+/* C += A * B written directly into the storage viewed by C */
+template <unsigned n, unsigned m, unsigned p, typename VA, typename VB>
+void multiply_add(FMatrixView<n, p> C, const MatrixView<n, m, VA>& A, const MatrixView<m, p, VB>& B)
+{
+    detail::dense_multiply<n, m, p>(A, B, C, true);
+}
+
+/** DATA ACCESS METHODS **/
+
+template <unsigned n, unsigned m, typename Value>
+Value& MatrixView<n, m, Value>::at(unsigned i, unsigned j) const
+{
+    if(i >= n || j >= m) { throw std::out_of_range("Matrix index out of range"); }
+
+    return at_unsafe(i, j);
+}
+
+template <unsigned n, unsigned m, typename Value>
+FMatrix<n, m> MatrixView<n, m, Value>::to_fmatrix() const
+{
+    FMatrix<n, m> A;
+
+    A.view().assign(*this);
+    return A;
+}
+
+/** SLICING **/
+
+template <unsigned n, unsigned m, typename Value>
+template <unsigned r, unsigned c>
+MatrixView<r, c, Value> MatrixView<n, m, Value>::submatrix(unsigned i, unsigned j) const
+{
+    static_assert(r <= n && c <= m, "Submatrix is larger than the matrix");
+
+    if (i > n - r || j > m - c) { throw std::out_of_range("Submatrix out of range"); }
+
+    return MatrixView<r, c, Value>(&at_unsafe(i, j), _row_stride, _col_stride);
+}
+
+/** ARITHMETIC OPERATIONS **/
+
+template <unsigned n, unsigned m, typename Value>
+template <typename V>
+FMatrix<n, m> MatrixView<n, m, Value>::add(const MatrixView<n, m, V>& rhs) const
+{
+    FMatrix<n, m> result = to_fmatrix();
+
+    result.view().add_into(rhs);
+    return result;
+}
+
+template <unsigned n, unsigned m, typename Value>
+template <typename V>
+MatrixView<n, m, Value>& MatrixView<n, m, Value>::add_into(const MatrixView<n, m, V>& rhs)
+{
+    for (unsigned i = 0; i < n; ++i)
+    {
+        for (unsigned j = 0; j < m; ++j)
+        {
+            at_unsafe(i, j) += rhs.at_unsafe(i, j);
+        }
+    }
+    return *this;
+}
+
+template <unsigned n, unsigned m, typename Value>
+template <typename V>
+MatrixView<n, m, Value>& MatrixView<n, m, Value>::assign(const MatrixView<n, m, V>& rhs)
+{
+    for (unsigned i = 0; i < n; ++i)
+    {
+        for (unsigned j = 0; j < m; ++j)
+        {
+            at_unsafe(i, j) = rhs.at_unsafe(i, j);
+        }
+    }
+    return *this;
+}
+
+template <unsigned n, unsigned m, typename Value>
+FMatrix<n, m> MatrixView<n, m, Value>::add(const FMatrix<n, m>& rhs) const
+{
+    return add(rhs.view());
+}
+
+template <unsigned n, unsigned m, typename Value>
+MatrixView<n, m, Value>& MatrixView<n, m, Value>::add_into(const FMatrix<n, m>& rhs)
+{
+    return add_into(rhs.view());
+}
+
+template <unsigned n, unsigned m, typename Value>
+MatrixView<n, m, Value>& MatrixView<n, m, Value>::assign(const FMatrix<n, m>& rhs)
+{
+    return assign(rhs.view());
+}
+
+template <unsigned n, unsigned m, typename Value>
+MatrixView<n, m, Value>& MatrixView<n, m, Value>::mult_into(const double& scalar)
+{
+    for (unsigned i = 0; i < n; ++i)
+    {
+        for (unsigned j = 0; j < m; ++j)
+        {
+            at_unsafe(i, j) *= scalar;
+        }
+    }
+    return *this;
+}
+
+template <unsigned n, unsigned m, typename Value>
+FMatrix<n, m> MatrixView<n, m, Value>::multiply(const double& scalar) const
+{
+    return to_fmatrix().mult_into(scalar);
+}
+
+template <unsigned n, unsigned m, typename Value>
+FMatrix<n, m> operator*(double scalar, const MatrixView<n, m, Value>& rhs)
+{
+    return rhs.multiply(scalar);
+}
+
+template <unsigned n, unsigned m, typename Value>
+template <unsigned p, typename V>
+FMatrix<n, p> MatrixView<n, m, Value>::multiply(const MatrixView<m, p, V>& B) const
+{
+    FMatrix<n, p> C;
+
+    detail::dense_multiply<n, m, p>(*this, B, C.view());
+    return C;
+}
+
+template <unsigned n, unsigned m, typename Value>
+template <unsigned p>
+FMatrix<n, p> MatrixView<n, m, Value>::multiply(const FMatrix<m, p>& B) const
+{
+    return multiply(B.view());
+}
+
+/** EQUALITY OPERATIONS **/
+
+template <unsigned n, unsigned m, typename Value>
+template <typename V>
+bool MatrixView<n, m, Value>::operator==(const MatrixView<n, m, V>& rhs) const noexcept
+{
+    for (unsigned i = 0; i < n; ++i)
+    {
+        for (unsigned j = 0; j < m; ++j)
+        {
+            if (at_unsafe(i, j) != rhs.at_unsafe(i, j)) { return false; }
+        }
+    }
+    return true;
+}
+
+template <unsigned n, unsigned m, typename Value>
+bool MatrixView<n, m, Value>::operator==(const FMatrix<n, m>& rhs) const noexcept
+{
+    return *this == rhs.view();
+}
+
+#endif // FLAT_MATRIX_VIEW_CPP_H
@@ -0,0 +1,626 @@
+/*
+
+File: instrumentation.hpp
+
+Brief: Opt-in per-kernel counters, timers and FLOP/byte accounting
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#ifndef INSTRUMENTATION_CPP_H
+#define INSTRUMENTATION_CPP_H
+
+#include <map>
+#include <mutex>
+#include <array>
+#include <tuple>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include <iomanip>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#ifdef MATRIX_CPP_PERF_EVENTS
+#include <cstring>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/*
+ * Per-kernel timing, FLOP and byte accounting. The hot kernels are wrapped
+ * in MATRIX_CPP_KERNEL_SCOPE (see kernel_scope.hpp); with
+ * MATRIX_CPP_INSTRUMENT defined, every call records its wall time, FLOPs,
+ * compulsory bytes moved (each operand read or written once) and shape into
+ * the process wide KernelRegistry, which can then be dumped as JSON or as a
+ * text report with roofline style rates. Without it the kernels never
+ * include this header.
+ *
+ * Calls are accumulated into slots owned by the recording thread, keyed on
+ * the kernel name pointer and dimensions, so recording takes no shared lock
+ * and allocates nothing once a shape has been seen. snapshot() merges the
+ * slots of every thread and only then builds the name strings.
+ *
+ * Defining MATRIX_CPP_PERF_EVENTS as well reads cycles, instructions and
+ * cache misses from Linux perf_event around each call. Counters the kernel
+ * refuses to open are reported as unavailable rather than failing.
+ *
+ * Both macros change the kernel definitions, so they must be set the same
+ * way for every translation unit of a program, i.e. as build flags.
+ * Scopes nest, so a kernel built from other kernels reports inclusive time.
+ */
+
+/* C(rows x cols) = A(rows x inner) * B(inner x cols). Inner is 0 for non products */
+struct KernelShape
+{
+    std::string name;
+    unsigned    rows  = 0;
+    unsigned    cols  = 0;
+    unsigned    inner = 0;
+
+    bool operator < (const KernelShape& rhs) const
+    {
+        return std::tie(name, rows, cols, inner) < std::tie(rhs.name, rhs.rows, rhs.cols, rhs.inner);
+    }
+};
+
+/* Recording key, the name is a string literal compared by address */
+struct KernelKey
+{
+    const char* name  = "";
+    unsigned    rows  = 0;
+    unsigned    cols  = 0;
+    unsigned    inner = 0;
+
+    bool operator == (const KernelKey& rhs) const noexcept
+    {
+        return name == rhs.name && rows == rhs.rows && cols == rhs.cols && inner == rhs.inner;
+    }
+};
+
+struct KernelKeyHash
+{
+    std::size_t operator()(const KernelKey& key) const noexcept
+    {
+        std::size_t hash = std::hash<const char*>()(key.name);
+        for (unsigned dim : { key.rows, key.cols, key.inner })
+        {
+            hash = (hash ^ dim) * 1099511628211ull;
+        }
+        return hash;
+    }
+};
+
+struct KernelStats
+{
+    static constexpr unsigned buckets = 48;
+
+    std::uint64_t calls    = 0;
+    std::uint64_t total_ns = 0;
+    std::uint64_t min_ns   = UINT64_MAX;
+    std::uint64_t max_ns   = 0;
+
+    // histogram[b] counts calls taking [2^b, 2^(b+1)) nanoseconds
+    std::array<std::uint64_t, buckets> histogram = {};
+
+    double        flops = 0;
+    double        bytes = 0;
+    std::uint64_t nnz   = 0; // Summed over calls
+
+    // Hardware counters, valid only when perf_calls > 0
+    std::uint64_t perf_calls   = 0;
+    std::uint64_t cycles       = 0;
+    std::uint64_t instructions = 0;
+    std::uint64_t cache_misses = 0;
+
+    void merge(const KernelStats& other) noexcept;
+
+    // Upper bound of the histogram bucket holding the q quantile, q in [0, 1]
+    std::uint64_t quantile_ns(double q) const noexcept;
+};
+
+/* One finished call, as handed to the registry */
+struct KernelSample
+{
+    std::uint64_t ns    = 0;
+    double        flops = 0;
+    double        bytes = 0;
+    unsigned      nnz   = 0;
+
+    bool          perf         = false;
+    std::uint64_t cycles       = 0;
+    std::uint64_t instructions = 0;
+    std::uint64_t cache_misses = 0;
+};
+
+class KernelRegistry
+{
+public:
+
+    KernelRegistry();
+
+    KernelRegistry(const KernelRegistry&) = delete;
+    KernelRegistry& operator=(const KernelRegistry&) = delete;
+
+    static KernelRegistry& instance()
+    {
+        static KernelRegistry registry;
+        return registry;
+    }
+
+    void record(const KernelKey& key, const KernelSample& sample);
+    void reset();
+
+    std::vector<std::pair<KernelShape, KernelStats>> snapshot() const;
+
+    /* Output */
+    void dump_json(std::ostream& out) const;
+    void report   (std::ostream& out) const;
+
+private:
+
+    // Stats recorded by one thread. Only that thread inserts, the mutex is
+    // shared with snapshot() and reset() and is otherwise uncontended.
+    struct ThreadSlots
+    {
+        std::thread::id owner;
+        std::mutex      mutex;
+        std::unordered_map<KernelKey, KernelStats, KernelKeyHash> stats;
+    };
+
+    ThreadSlots& thread_slots();
+
+    const std::uint64_t _id; // Never reused, so thread caches cannot go stale
+
+    mutable std::mutex                        _mutex; // Guards _threads
+    std::vector<std::unique_ptr<ThreadSlots>> _threads;
+};
+
+/*
+ * Cycles, instructions and cache misses of the calling thread, read as one
+ * perf_event group. Each thread opens its own group on first use.
+ */
+class PerfCounters
+{
+public:
+
+    struct Reading
+    {
+        std::uint64_t cycles       = 0;
+        std::uint64_t instructions = 0;
+        std::uint64_t cache_misses = 0;
+    };
+
+    static PerfCounters& thread_local_counters()
+    {
+        thread_local PerfCounters counters;
+        return counters;
+    }
+
+    bool available() const noexcept { return _fds[0] != -1; }
+
+    // False if the counters could not be opened or read
+    bool read(Reading& reading) const noexcept;
+
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+private:
+
+    void close_all() noexcept;
+
+    int _fds[3] = { -1, -1, -1 };
+};
+
+/* Times the enclosing block and records it into a registry on exit */
+class KernelScope
+{
+public:
+
+    KernelScope(const char* name, unsigned rows, unsigned cols, unsigned inner = 0,
+                double flops = 0, double bytes = 0, unsigned nnz = 0,
+                KernelRegistry& registry = KernelRegistry::instance());
+    ~KernelScope();
+
+    KernelScope(const KernelScope&) = delete;
+    KernelScope& operator=(const KernelScope&) = delete;
+
+    // Sets the work for kernels that only know it once they finish
+    void work(double flops, double bytes, unsigned nnz = 0) noexcept
+    {
+        _sample.flops = flops;
+        _sample.bytes = bytes;
+        _sample.nnz   = nnz;
+    }
+
+private:
+
+    KernelKey       _key;
+    KernelRegistry& _registry;
+    KernelSample    _sample;
+
+    PerfCounters::Reading                 _perf_start;
+    std::chrono::steady_clock::time_point _start;
+};
+
+/** KERNEL STATS **/
+
+inline void KernelStats::merge(const KernelStats& other) noexcept
+{
+    calls    += other.calls;
+    total_ns += other.total_ns;
+    min_ns    = std::min(min_ns, other.min_ns);
+    max_ns    = std::max(max_ns, other.max_ns);
+    flops    += other.flops;
+    bytes    += other.bytes;
+    nnz      += other.nnz;
+
+    for (unsigned b = 0; b < buckets; ++b) { histogram[b] += other.histogram[b]; }
+
+    perf_calls   += other.perf_calls;
+    cycles       += other.cycles;
+    instructions += other.instructions;
+    cache_misses += other.cache_misses;
+}
+
+inline std::uint64_t KernelStats::quantile_ns(double q) const noexcept
+{
+    const double target = q * calls;
+
+    std::uint64_t seen = 0;
+    for (unsigned b = 0; b < buckets; ++b)
+    {
+        seen += histogram[b];
+        if (seen > 0 && seen >= target) { return (std::uint64_t(1) << (b + 1)) - 1; }
+    }
+    return max_ns;
+}
+
+/** KERNEL REGISTRY **/
+
+namespace detail
+{
+
+inline std::uint64_t next_registry_id() noexcept
+{
+    static std::atomic<std::uint64_t> id { 0 };
+    return ++id;
+}
+
+} // namespace detail
+
+inline KernelRegistry::KernelRegistry()
+    : _id(detail::next_registry_id())
+{}
+
+inline KernelRegistry::ThreadSlots& KernelRegistry::thread_slots()
+{
+    // Threads usually record into one registry, remember the last one used
+    thread_local std::uint64_t cached_id    = 0;
+    thread_local ThreadSlots*  cached_slots = nullptr;
+
+    if (cached_id == _id) { return *cached_slots; }
+
+    const std::thread::id self = std::this_thread::get_id();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Ids of finished threads are reused, so their slots are picked up again
+    auto it = std::find_if(_threads.begin(), _threads.end(),
+                           [&](const std::unique_ptr<ThreadSlots>& slots) { return slots->owner == self; });
+    if (it == _threads.end())
+    {
+        _threads.push_back(std::make_unique<ThreadSlots>());
+        _threads.back()->owner = self;
+        it = _threads.end() - 1;
+    }
+    cached_id    = _id;
+    cached_slots = it->get();
+    return *cached_slots;
+}
+
+inline void KernelRegistry::record(const KernelKey& key, const KernelSample& sample)
+{
+    unsigned bucket = 0;
+    for (std::uint64_t ns = sample.ns; ns > 1 && bucket + 1 < KernelStats::buckets; ns >>= 1) { ++bucket; }
+
+    ThreadSlots& slots = thread_slots();
+    std::lock_guard<std::mutex> lock(slots.mutex);
+
+    KernelStats& stats = slots.stats[key];
+    ++stats.calls;
+    ++stats.histogram[bucket];
+    stats.total_ns += sample.ns;
+    stats.min_ns    = std::min(stats.min_ns, sample.ns);
+    stats.max_ns    = std::max(stats.max_ns, sample.ns);
+    stats.flops    += sample.flops;
+    stats.bytes    += sample.bytes;
+    stats.nnz      += sample.nnz;
+
+    if (sample.perf)
+    {
+        ++stats.perf_calls;
+        stats.cycles       += sample.cycles;
+        stats.instructions += sample.instructions;
+        stats.cache_misses += sample.cache_misses;
+    }
+}
+
+inline void KernelRegistry::reset()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto& slots : _threads)
+    {
+        std::lock_guard<std::mutex> slots_lock(slots->mutex);
+        slots->stats.clear();
+    }
+}
+
+inline std::vector<std::pair<KernelShape, KernelStats>> KernelRegistry::snapshot() const
+{
+    std::map<KernelShape, KernelStats> merged;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const auto& slots : _threads)
+        {
+            std::lock_guard<std::mutex> slots_lock(slots->mutex);
+            for (const auto& entry : slots->stats)
+            {
+                const KernelKey& key = entry.first;
+                merged[KernelShape{ key.name, key.rows, key.cols, key.inner }].merge(entry.second);
+            }
+        }
+    }
+    return { merged.begin(), merged.end() };
+}
+
+namespace detail
+{
+
+// Amount per second, given the total time in nanoseconds
+inline double per_second(double amount, std::uint64_t ns) noexcept
+{
+    return ns == 0 ? 0.0 : amount * 1e9 / ns;
+}
+
+inline void write_json_string(std::ostream& out, const std::string& text)
+{
+    out << '"';
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\') { out << '\\'; }
+        out << c;
+    }
+    out << '"';
+}
+
+} // namespace detail
+
+/*
+ * {"kernels": [{"name", "rows", "cols", "inner", "calls", "total_ns", ...,
+ * "histogram_ns": [...], "perf": {...}}]}. Histogram entry b counts calls
+ * taking [2^b, 2^(b+1)) ns and is trimmed after the last nonzero bucket.
+ */
+inline void KernelRegistry::dump_json(std::ostream& out) const
+{
+    const auto stats = snapshot();
+
+    const std::ios_base::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision(9);
+    out.unsetf(std::ios_base::floatfield);
+
+    out << "{\"kernels\":[";
+    for (std::size_t k = 0; k < stats.size(); ++k)
+    {
+        const KernelShape& shape = stats[k].first;
+        const KernelStats& s     = stats[k].second;
+
+        out << (k ? "," : "") << "{\"name\":";
+        detail::write_json_string(out, shape.name);
+        out << ",\"rows\":"     << shape.rows
+            << ",\"cols\":"     << shape.cols
+            << ",\"inner\":"    << shape.inner
+            << ",\"calls\":"    << s.calls
+            << ",\"total_ns\":" << s.total_ns
+            << ",\"min_ns\":"   << s.min_ns
+            << ",\"max_ns\":"   << s.max_ns
+            << ",\"p50_ns\":"   << s.quantile_ns(0.50)
+            << ",\"p99_ns\":"   << s.quantile_ns(0.99)
+            << ",\"flops\":"    << s.flops
+            << ",\"bytes\":"    << s.bytes
+            << ",\"nnz\":"      << s.nnz
+            << ",\"gflops\":"   << detail::per_second(s.flops, s.total_ns) * 1e-9
+            << ",\"gbytes_per_s\":" << detail::per_second(s.bytes, s.total_ns) * 1e-9
+            << ",\"intensity\":"    << (s.bytes > 0 ? s.flops / s.bytes : 0.0);
+
+        unsigned used = KernelStats::buckets;
+        while (used > 0 && s.histogram[used - 1] == 0) { --used; }
+
+        out << ",\"histogram_ns\":[";
+        for (unsigned b = 0; b < used; ++b) { out << (b ? "," : "") << s.histogram[b]; }
+        out << "]";
+
+        if (s.perf_calls > 0)
+        {
+            out << ",\"perf\":{\"calls\":"        << s.perf_calls
+                << ",\"cycles\":"       << s.cycles
+                << ",\"instructions\":" << s.instructions
+                << ",\"cache_misses\":" << s.cache_misses
+                << ",\"ipc\":" << (s.cycles ? double(s.instructions) / s.cycles : 0.0) << "}";
+        }
+        out << "}";
+    }
+    out << "]}\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+/* One line per kernel shape: time, rates, arithmetic intensity and counters */
+inline void KernelRegistry::report(std::ostream& out) const
+{
+    const auto stats = snapshot();
+
+    const std::ios_base::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision(3);
+    out.setf(std::ios_base::fixed, std::ios_base::floatfield);
+
+    out << std::left  << std::setw(24) << "kernel" << std::setw(18) << "shape"
+        << std::right << std::setw(10) << "calls"  << std::setw(12) << "total ms"
+        << std::setw(12) << "mean us" << std::setw(12) << "p99 us"
+        << std::setw(10) << "GFLOP/s" << std::setw(10) << "GB/s"
+        << std::setw(10) << "FLOP/B"  << std::setw(8)  << "IPC"
+        << std::setw(14) << "misses/call" << "\n";
+
+    for (const auto& entry : stats)
+    {
+        const KernelShape& shape = entry.first;
+        const KernelStats& s     = entry.second;
+
+        std::string dims = std::to_string(shape.rows) + "x" + std::to_string(shape.cols);
+        if (shape.inner) { dims += "x" + std::to_string(shape.inner); }
+
+        out << std::left  << std::setw(24) << shape.name << std::setw(18) << dims
+            << std::right << std::setw(10) << s.calls
+            << std::setw(12) << s.total_ns * 1e-6
+            << std::setw(12) << (s.calls ? s.total_ns * 1e-3 / s.calls : 0.0)
+            << std::setw(12) << s.quantile_ns(0.99) * 1e-3
+            << std::setw(10) << detail::per_second(s.flops, s.total_ns) * 1e-9
+            << std::setw(10) << detail::per_second(s.bytes, s.total_ns) * 1e-9
+            << std::setw(10) << (s.bytes > 0 ? s.flops / s.bytes : 0.0);
+
+        if (s.perf_calls > 0)
+        {
+            out << std::setw(8)  << (s.cycles ? double(s.instructions) / s.cycles : 0.0)
+                << std::setw(14) << double(s.cache_misses) / s.perf_calls;
+        }
+        else
+        {
+            out << std::setw(8) << "-" << std::setw(14) << "-";
+        }
+        out << "\n";
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+/** PERF COUNTERS **/
+
+#ifdef MATRIX_CPP_PERF_EVENTS
+
+inline PerfCounters::PerfCounters()
+{
+    const std::uint64_t events[3] = { PERF_COUNT_HW_CPU_CYCLES,
+                                      PERF_COUNT_HW_INSTRUCTIONS,
+                                      PERF_COUNT_HW_CACHE_MISSES };
+    for (unsigned e = 0; e < 3; ++e)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.size           = sizeof(attr);
+        attr.config         = events[e];
+        attr.read_format    = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+
+        const int fd = syscall(SYS_perf_event_open, &attr, 0, -1, e ? _fds[0] : -1, 0);
+        if (fd == -1)
+        {
+            close_all();
+            return;
+        }
+        _fds[e] = fd;
+    }
+}
+
+inline PerfCounters::~PerfCounters()
+{
+    close_all();
+}
+
+inline void PerfCounters::close_all() noexcept
+{
+    for (int& fd : _fds)
+    {
+        if (fd != -1) { close(fd); }
+        fd = -1;
+    }
+}
+
+inline bool PerfCounters::read(Reading& reading) const noexcept
+{
+    if (!available()) { return false; }
+
+    std::uint64_t values[4] = {}; // { nr, cycles, instructions, cache misses }
+    if (::read(_fds[0], values, sizeof(values)) != sizeof(values)) { return false; }
+
+    reading.cycles       = values[1];
+    reading.instructions = values[2];
+    reading.cache_misses = values[3];
+    return true;
+}
+
+#else
+
+inline PerfCounters::PerfCounters()  = default;
+inline PerfCounters::~PerfCounters() = default;
+
+inline void PerfCounters::close_all() noexcept {}
+
+inline bool PerfCounters::read(Reading&) const noexcept { return false; }
+
+#endif // MATRIX_CPP_PERF_EVENTS
+
+/** KERNEL SCOPE **/
+
+inline KernelScope::KernelScope(const char* name, unsigned rows, unsigned cols, unsigned inner,
+                                double flops, double bytes, unsigned nnz, KernelRegistry& registry)
+    : _key{ name, rows, cols, inner }, _registry(registry)
+{
+    work(flops, bytes, nnz);
+
+    _sample.perf = PerfCounters::thread_local_counters().read(_perf_start);
+    _start       = std::chrono::steady_clock::now();
+}
+
+inline KernelScope::~KernelScope()
+{
+    const auto stop = std::chrono::steady_clock::now();
+
+    PerfCounters::Reading perf_stop;
+    if (_sample.perf && PerfCounters::thread_local_counters().read(perf_stop))
+    {
+        _sample.cycles       = perf_stop.cycles       - _perf_start.cycles;
+        _sample.instructions = perf_stop.instructions - _perf_start.instructions;
+        _sample.cache_misses = perf_stop.cache_misses - _perf_start.cache_misses;
+    }
+    else
+    {
+        _sample.perf = false;
+    }
+    _sample.ns = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - _start).count();
+
+    try
+    {
+        _registry.record(_key, _sample);
+    }
+    catch (...) {} // Instrumentation never fails the kernel it measures
+}
+
+#endif // INSTRUMENTATION_CPP_H
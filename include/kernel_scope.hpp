@@ -0,0 +1,34 @@
+/*
+
+File: kernel_scope.hpp
+
+Brief: Kernel instrumentation hooks, empty unless MATRIX_CPP_INSTRUMENT is set
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#ifndef KERNEL_SCOPE_CPP_H
+#define KERNEL_SCOPE_CPP_H
+
+/*
+ * Included by the kernel headers in place of instrumentation.hpp so default
+ * builds pull in neither the registry nor its dependencies.
+ */
+#ifdef MATRIX_CPP_INSTRUMENT
+
+#include <instrumentation.hpp>
+
+#define MATRIX_CPP_KERNEL_SCOPE(...) KernelScope matrix_cpp_kernel_scope_(__VA_ARGS__)
+#define MATRIX_CPP_KERNEL_WORK(...)  matrix_cpp_kernel_scope_.work(__VA_ARGS__)
+
+#else
+
+#define MATRIX_CPP_KERNEL_SCOPE(...) ((void)0)
+#define MATRIX_CPP_KERNEL_WORK(...)  ((void)0)
+
+#endif // MATRIX_CPP_INSTRUMENT
+
+#endif // KERNEL_SCOPE_CPP_H
@@ -0,0 +1,415 @@
+/*
+
+File: matrix_file.hpp
+
+Brief: Versioned binary file format for FMatrix and CSRMatrix with
+       memory-mapped, zero-copy readers
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#ifndef MATRIX_FILE_CPP_H
+#define MATRIX_FILE_CPP_H
+
+#include <cstdio>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fmatrix.hpp>
+#include <csr_matrix.hpp>
+
+/*
+ * File layout, all sections start on a MATRIX_FILE_ALIGNMENT byte boundary:
+ *
+ *   MatrixFileHeader
+ *   Dense: rows * cols doubles, row major (FMatrix::_fmat)
+ *   CSR:   rows + 1 unsigned row offsets (CSRMatrix::_row)
+ *          nnz unsigned column indices   (CSRMatrix::_cols)
+ *          nnz doubles                   (CSRMatrix::_vals)
+ *
+ * Arrays are stored in native byte order and width so a mapped file can be
+ * used in place. The header records both and readers reject foreign files.
+ */
+constexpr std::uint32_t MATRIX_FILE_VERSION    = 1;
+constexpr std::uint32_t MATRIX_FILE_BYTE_ORDER = 0x01020304;
+constexpr std::uint64_t MATRIX_FILE_ALIGNMENT  = 64;
+
+enum class MatrixFileKind : std::uint32_t { Dense = 0, CSR = 1 };
+
+struct MatrixFileHeader
+{
+    char          magic[8]   = { 'M', 'C', 'P', 'P', 'M', 'A', 'T', '\0' };
+    std::uint32_t version    = MATRIX_FILE_VERSION;
+    std::uint32_t byte_order = MATRIX_FILE_BYTE_ORDER;
+    std::uint32_t index_size = sizeof(unsigned);
+    std::uint32_t kind       = 0;
+
+    std::uint64_t rows = 0;
+    std::uint64_t cols = 0;
+    std::uint64_t nnz  = 0;
+
+    // Byte offsets of each section from the start of the file
+    std::uint64_t row_offset  = 0;
+    std::uint64_t cols_offset = 0;
+    std::uint64_t vals_offset = 0;
+
+    std::uint8_t  reserved[56] = {};
+};
+
+static_assert(sizeof(MatrixFileHeader) == 2 * MATRIX_FILE_ALIGNMENT,
+              "Matrix file header must keep the sections aligned");
+
+namespace detail
+{
+
+inline std::uint64_t align_up(std::uint64_t offset) noexcept
+{
+    return (offset + MATRIX_FILE_ALIGNMENT - 1) & ~(MATRIX_FILE_ALIGNMENT - 1);
+}
+
+inline void write_section(std::ofstream& file, const void* data, std::uint64_t bytes)
+{
+    static const char padding[MATRIX_FILE_ALIGNMENT] = {};
+
+    file.write(static_cast<const char*>(data), bytes);
+    file.write(padding, align_up(bytes) - bytes);
+}
+
+/*
+ * The matrix is written to a temporary file beside path and renamed over it,
+ * so processes that still map the old file keep its inode and never see a
+ * truncated or half written matrix.
+ */
+inline void write_file(const std::string& path, const MatrixFileHeader& header,
+                       const void* row, const void* cols, const void* vals)
+{
+    const std::string temp = path + ".tmp." + std::to_string(::getpid());
+
+    std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+    if (!file) { throw std::runtime_error("Unable to open " + temp + " for writing"); }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (row)
+    {
+        write_section(file, row, (header.rows + 1) * sizeof(unsigned));
+        write_section(file, cols, header.nnz * sizeof(unsigned));
+    }
+    write_section(file, vals, header.nnz * sizeof(double));
+    file.close();
+
+    if (!file || std::rename(temp.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temp.c_str());
+        throw std::runtime_error("Failed writing matrix to " + path);
+    }
+}
+
+} // namespace detail
+
+template <unsigned n, unsigned m>
+void write_matrix(const std::string& path, const FMatrix<n,m>& A)
+{
+    MatrixFileHeader header;
+    header.kind        = static_cast<std::uint32_t>(MatrixFileKind::Dense);
+    header.rows        = n;
+    header.cols        = m;
+    header.nnz         = static_cast<std::uint64_t>(n) * m;
+    header.vals_offset = sizeof(MatrixFileHeader);
+
+    detail::write_file(path, header, nullptr, nullptr, A._fmat);
+}
+
+template <unsigned n, unsigned m>
+void write_matrix(const std::string& path, const CSRMatrix<n,m>& A)
+{
+    MatrixFileHeader header;
+    header.kind        = static_cast<std::uint32_t>(MatrixFileKind::CSR);
+    header.rows        = n;
+    header.cols        = m;
+    header.nnz         = A.nnz();
+    header.row_offset  = sizeof(MatrixFileHeader);
+    header.cols_offset = header.row_offset  + detail::align_up((n + 1) * sizeof(unsigned));
+    header.vals_offset = header.cols_offset + detail::align_up(header.nnz * sizeof(unsigned));
+
+    detail::write_file(path, header, A._row, A._cols.data(), A._vals.data());
+}
+
+/*
+ * Read-only shared mapping of an entire file. Pages are faulted in on first
+ * access and are shared through the page cache with every other process
+ * mapping the same file.
+ */
+class MappedFile
+{
+public:
+
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char*   data() const noexcept { return static_cast<const char*>(_data); }
+    std::uint64_t size() const noexcept { return _size; }
+
+private:
+
+    void*         _data = nullptr;
+    std::uint64_t _size = 0;
+};
+
+inline MappedFile::MappedFile(const std::string& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { throw std::system_error(errno, std::generic_category(), path); }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0)
+    {
+        const int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), path);
+    }
+    _size = info.st_size;
+
+    if (_size > 0)
+    {
+        _data = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+        if (_data == MAP_FAILED)
+        {
+            const int error = errno;
+            _data = nullptr;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), path);
+        }
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+}
+
+inline MappedFile::~MappedFile()
+{
+    if (_data) { ::munmap(_data, _size); }
+}
+
+namespace detail
+{
+
+inline const MatrixFileHeader& read_header(const MappedFile& file, MatrixFileKind kind,
+                                           std::uint64_t rows, std::uint64_t cols)
+{
+    if (file.size() < sizeof(MatrixFileHeader))
+    {
+        throw std::runtime_error("Matrix file is too small to hold a header");
+    }
+
+    const MatrixFileHeader& header = *reinterpret_cast<const MatrixFileHeader*>(file.data());
+    const MatrixFileHeader  expected;
+
+    if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0)
+    {
+        throw std::runtime_error("Not a matrix file");
+    }
+    if (header.version != MATRIX_FILE_VERSION)
+    {
+        throw std::runtime_error("Unsupported matrix file version");
+    }
+    if (header.byte_order != MATRIX_FILE_BYTE_ORDER || header.index_size != sizeof(unsigned))
+    {
+        throw std::runtime_error("Matrix file was written on an incompatible platform");
+    }
+    if (header.kind != static_cast<std::uint32_t>(kind))
+    {
+        throw std::runtime_error("Matrix file holds a different storage format");
+    }
+    if (header.rows != rows || header.cols != cols)
+    {
+        throw std::runtime_error("Matrix file dimensions do not match");
+    }
+
+    if (kind == MatrixFileKind::Dense && header.nnz != rows * cols)
+    {
+        throw std::runtime_error("Matrix file holds the wrong number of dense entries");
+    }
+
+    // Sizes are checked by division so a corrupt count cannot wrap the product
+    auto section_fits = [&](std::uint64_t offset, std::uint64_t count, std::uint64_t size)
+    {
+        return offset % MATRIX_FILE_ALIGNMENT == 0
+            && offset <= file.size() && count <= (file.size() - offset) / size;
+    };
+
+    bool valid = section_fits(header.vals_offset, header.nnz, sizeof(double));
+    if (kind == MatrixFileKind::CSR)
+    {
+        valid = valid && section_fits(header.row_offset,  rows + 1,   sizeof(unsigned))
+                      && section_fits(header.cols_offset, header.nnz, sizeof(unsigned));
+    }
+    if (!valid) { throw std::runtime_error("Matrix file is truncated or corrupt"); }
+
+    return header;
+}
+
+} // namespace detail
+
+/*
+ * Read-only dense matrix backed directly by a mapped matrix file. Copies share
+ * the mapping.
+ */
+template <unsigned n, unsigned m>
+class MappedFMatrix
+{
+public:
+
+    using const_iterator = const double*;
+
+    explicit MappedFMatrix(const std::string& path);
+
+    const double& at(unsigned i, unsigned j) const;
+
+    const_iterator begin() const noexcept { return _fmat; }
+    const_iterator end()   const noexcept { return _fmat + (n * m); }
+
+    const_iterator operator[](unsigned i) const noexcept { return _fmat + (m * i); }
+
+    ConstFMatrixView<n,m> view() const noexcept { return ConstFMatrixView<n,m>(_fmat, m); }
+
+    FMatrix<n,m> to_fmatrix() const { return view().to_fmatrix(); }
+
+    template <unsigned p, typename V>
+    FMatrix<n, p> multiply (const MatrixView<m, p, V>& rhs) const { return view().multiply(rhs); }
+    template <unsigned p, typename V>
+    FMatrix<n, p> operator* (const MatrixView<m, p, V>& rhs) const { return multiply(rhs); }
+
+    template <unsigned p>
+    FMatrix<n, p> multiply (const FMatrix<m, p>& rhs) const { return view().multiply(rhs); }
+    template <unsigned p>
+    FMatrix<n, p> operator* (const FMatrix<m, p>& rhs) const { return multiply(rhs); }
+
+    std::shared_ptr<const MappedFile> _file;
+    const double* _fmat = nullptr;
+};
+
+template <unsigned n, unsigned m>
+MappedFMatrix<n,m>::MappedFMatrix(const std::string& path)
+    : _file(std::make_shared<const MappedFile>(path))
+{
+    const MatrixFileHeader& header = detail::read_header(*_file, MatrixFileKind::Dense, n, m);
+
+    _fmat = reinterpret_cast<const double*>(_file->data() + header.vals_offset);
+}
+
+template <unsigned n, unsigned m>
+const double& MappedFMatrix<n,m>::at(unsigned i, unsigned j) const
+{
+    if(i >= n || j >= m) { throw std::out_of_range("Matrix index out of range"); }
+
+    return _fmat[(i * m) + j];
+}
+
+/*
+ * Read-only CSR matrix backed directly by a mapped matrix file. Copies share
+ * the mapping.
+ */
+template <unsigned n, unsigned m>
+class MappedCSRMatrix
+{
+public:
+
+    explicit MappedCSRMatrix(const std::string& path);
+
+    unsigned nnz() const noexcept { return _row[n]; }
+
+    CSRMatrix<n,m> to_csr() const;
+    FMatrix<n,m>   to_fmatrix() const;
+
+    template <unsigned p, typename V>
+    FMatrix<n, p> multiply (const MatrixView<m, p, V>& rhs) const;
+    template <unsigned p, typename V>
+    FMatrix<n, p> operator* (const MatrixView<m, p, V>& rhs) const { return multiply(rhs); }
+
+    template <unsigned p>
+    FMatrix<n, p> multiply (const FMatrix<m, p>& rhs) const { return multiply(rhs.view()); }
+    template <unsigned p>
+    FMatrix<n, p> operator* (const FMatrix<m, p>& rhs) const { return multiply(rhs); }
+
+    std::shared_ptr<const MappedFile> _file;
+
+    const unsigned* _row  = nullptr;
+    const unsigned* _cols = nullptr;
+    const double*   _vals = nullptr;
+};
+
+template <unsigned n, unsigned m>
+MappedCSRMatrix<n,m>::MappedCSRMatrix(const std::string& path)
+    : _file(std::make_shared<const MappedFile>(path))
+{
+    const MatrixFileHeader& header = detail::read_header(*_file, MatrixFileKind::CSR, n, m);
+
+    _row  = reinterpret_cast<const unsigned*>(_file->data() + header.row_offset);
+    _cols = reinterpret_cast<const unsigned*>(_file->data() + header.cols_offset);
+    _vals = reinterpret_cast<const double*>  (_file->data() + header.vals_offset);
+
+    // Validate the structure once so the kernels can index without checks
+    bool valid = _row[0] == 0 && _row[n] == header.nnz;
+    for (unsigned i = 0; valid && i < n; ++i)
+    {
+        valid = _row[i] <= _row[i+1];
+    }
+    for (std::uint64_t k = 0; valid && k < header.nnz; ++k)
+    {
+        valid = _cols[k] < m;
+    }
+    if (!valid) { throw std::runtime_error("Matrix file holds a malformed CSR structure"); }
+}
+
+template <unsigned n, unsigned m>
+CSRMatrix<n,m> MappedCSRMatrix<n,m>::to_csr() const
+{
+    CSRMatrix<n,m> A;
+
+    std::copy(_row, _row + n + 1, A._row);
+    A._cols.assign(_cols, _cols + nnz());
+    A._vals.assign(_vals, _vals + nnz());
+    return A;
+}
+
+template <unsigned n, unsigned m>
+FMatrix<n,m> MappedCSRMatrix<n,m>::to_fmatrix() const
+{
+    FMatrix<n,m> A;
+
+    for(unsigned i = 0; i < n; ++i)
+    {
+        for (unsigned j = _row[i]; j < _row[i+1]; ++j)
+        {
+            A[i][_cols[j]] = _vals[j];
+        }
+    }
+    return A;
+}
+
+template <unsigned n, unsigned m>
+template <unsigned p, typename V>
+FMatrix<n, p> MappedCSRMatrix<n,m>::multiply (const MatrixView<m, p, V>& B) const
+{
+    FMatrix<n,p> C;
+
+    detail::csr_multiply<n, m, p>(_row, _cols, _vals, B, C.view());
+    return C;
+}
+
+#endif // MATRIX_FILE_CPP_H
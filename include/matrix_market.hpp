@@ -0,0 +1,366 @@
+/*
+
+File: matrix_market.hpp
+
+Brief: Matrix Market coordinate format reader and writer for CSR matrices
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#ifndef MATRIX_MARKET_CPP_H
+#define MATRIX_MARKET_CPP_H
+
+#include <atomic>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <numeric>
+#include <utility>
+#include <sstream>
+#include <fstream>
+#include <charconv>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+
+#include <fmatrix.hpp>
+#include <parallel.hpp>
+#include <csr_matrix.hpp>
+#include <matrix_file.hpp>
+
+enum class MarketField    { Real, Integer, Pattern };
+enum class MarketSymmetry { General, Symmetric, SkewSymmetric };
+
+namespace detail
+{
+
+struct MarketHeader
+{
+    MarketField    field    = MarketField::Real;
+    MarketSymmetry symmetry = MarketSymmetry::General;
+
+    unsigned long long rows    = 0;
+    unsigned long long cols    = 0;
+    unsigned long long entries = 0;
+
+    const char* body = nullptr; // First byte after the size line
+};
+
+inline const char* line_end(const char* p, const char* end) noexcept
+{
+    const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    return eol ? eol : end;
+}
+
+inline const char* skip_blanks(const char* p, const char* end) noexcept
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) { ++p; }
+    return p;
+}
+
+inline MarketHeader parse_market_header(const char* p, const char* end)
+{
+    MarketHeader header;
+
+    const char* eol = line_end(p, end);
+    std::string banner(p, eol);
+    std::transform(banner.begin(), banner.end(), banner.begin(),
+                  [](unsigned char c) { return std::tolower(c); });
+
+    std::istringstream tokens(banner);
+    std::string magic, object, format, field, symmetry;
+    tokens >> magic >> object >> format >> field >> symmetry;
+
+    if (magic != "%%matrixmarket" || object != "matrix")
+    {
+        throw std::runtime_error("Missing Matrix Market banner");
+    }
+    if (format != "coordinate")
+    {
+        throw std::runtime_error("Only the Matrix Market coordinate format is supported");
+    }
+
+    if      (field == "real" || field == "double") { header.field = MarketField::Real;    }
+    else if (field == "integer")                   { header.field = MarketField::Integer; }
+    else if (field == "pattern")                   { header.field = MarketField::Pattern; }
+    else { throw std::runtime_error("Unsupported Matrix Market field: " + field); }
+
+    if      (symmetry == "general")        { header.symmetry = MarketSymmetry::General;       }
+    else if (symmetry == "symmetric")      { header.symmetry = MarketSymmetry::Symmetric;     }
+    else if (symmetry == "skew-symmetric") { header.symmetry = MarketSymmetry::SkewSymmetric; }
+    else { throw std::runtime_error("Unsupported Matrix Market symmetry: " + symmetry); }
+
+    // Skip comments and blank lines up to the size line
+    p = eol;
+    while (p < end)
+    {
+        p = skip_blanks(p + (*p == '\n'), end);
+        if (p < end && *p != '%' && *p != '\n') { break; }
+        p = line_end(p, end);
+    }
+
+    eol = line_end(p, end);
+    std::istringstream size_line(std::string(p, eol));
+    if (!(size_line >> header.rows >> header.cols >> header.entries))
+    {
+        throw std::runtime_error("Malformed Matrix Market size line");
+    }
+    header.body = eol;
+    return header;
+}
+
+/*
+ * Parses every entry in [p, end), calling visit(i, j, value) with zero based
+ * indices. Symmetric entries are visited in both triangles. Returns the
+ * number of entries read from the file.
+ */
+template <typename Visit>
+unsigned long long parse_market_entries(const char* p, const char* end,
+                                        const MarketHeader& header, Visit&& visit)
+{
+    auto fail = [](const char* what) { throw std::runtime_error(what); };
+
+    unsigned long long entries = 0;
+    while (p < end)
+    {
+        p = skip_blanks(p, end);
+        if (p == end) { break; }
+        if (*p == '\n') { ++p; continue; }
+        if (*p == '%')  { p = line_end(p, end); continue; }
+
+        unsigned i = 0, j = 0;
+        double value = 1.0;
+
+        auto result = std::from_chars(p, end, i);
+        if (result.ec != std::errc()) { fail("Malformed Matrix Market entry"); }
+
+        p = skip_blanks(result.ptr, end);
+        result = std::from_chars(p, end, j);
+        if (result.ec != std::errc()) { fail("Malformed Matrix Market entry"); }
+        p = result.ptr;
+
+        if (header.field != MarketField::Pattern)
+        {
+            p = skip_blanks(p, end);
+            p += (p < end && *p == '+');
+            result = std::from_chars(p, end, value);
+            if (result.ec != std::errc()) { fail("Malformed Matrix Market value"); }
+            p = result.ptr;
+        }
+
+        p = skip_blanks(p, end);
+        if (p < end && *p != '\n') { fail("Unexpected trailing data in Matrix Market entry"); }
+
+        if (i == 0 || j == 0 || i > header.rows || j > header.cols)
+        {
+            fail("Matrix Market entry index out of range");
+        }
+
+        visit(i - 1, j - 1, value);
+        if (header.symmetry != MarketSymmetry::General && i != j)
+        {
+            visit(j - 1, i - 1, header.symmetry == MarketSymmetry::SkewSymmetric ? -value : value);
+        }
+        ++entries;
+    }
+    return entries;
+}
+
+// Splits [begin, end) into chunks that start at the beginning of a line
+inline std::vector<const char*> split_lines(const char* begin, const char* end, unsigned chunks)
+{
+    std::vector<const char*> bounds { begin };
+    for (unsigned t = 1; t < chunks; ++t)
+    {
+        const char* p = begin + ((end - begin) * static_cast<unsigned long long>(t)) / chunks;
+        p = std::max(p, bounds.back());
+        p = line_end(p, end);
+        bounds.push_back(p + (p < end));
+    }
+    bounds.push_back(end);
+    return bounds;
+}
+
+} // namespace detail
+
+/*
+ * Reads a Matrix Market coordinate file straight into CSR storage. The file is
+ * memory mapped and parsed twice, once to count the entries in each row and
+ * once to scatter them, so memory use is bounded by the output matrix. Both
+ * passes split the file into line aligned chunks parsed by separate threads.
+ * Repeated coordinates are summed into a single entry, including those a
+ * symmetric file produces by storing both triangles.
+ */
+template <unsigned n, unsigned m>
+CSRMatrix<n,m> read_matrix_market(const std::string& path, unsigned threads = 1)
+{
+    MappedFile file(path);
+    const char* const begin = file.data();
+    const char* const end   = file.data() + file.size();
+
+    const detail::MarketHeader header = detail::parse_market_header(begin, end);
+
+    if (header.rows != n || header.cols != m)
+    {
+        throw std::runtime_error("Matrix Market dimensions do not match");
+    }
+    if (header.symmetry != MarketSymmetry::General && n != m)
+    {
+        throw std::runtime_error("Symmetric Matrix Market files must be square");
+    }
+
+    threads = std::max(1u, threads);
+    const std::vector<const char*> chunks = detail::split_lines(header.body, end, threads);
+
+    // Pass 1: count the entries in each row
+    std::vector<std::atomic<unsigned>> cursor(n);
+    std::atomic<unsigned long long> stored  { 0 };
+    std::atomic<unsigned long long> entries { 0 };
+
+    detail::for_each_chunk(threads, [&](unsigned t)
+    {
+        unsigned long long local_stored = 0;
+        entries += detail::parse_market_entries(chunks[t], chunks[t+1], header,
+        [&](unsigned i, unsigned, double)
+        {
+            cursor[i].fetch_add(1, std::memory_order_relaxed);
+            ++local_stored;
+        });
+        stored += local_stored;
+    });
+
+    if (entries != header.entries)
+    {
+        throw std::runtime_error("Matrix Market entry count does not match the size line");
+    }
+
+    CSRMatrix<n,m> A;
+    A._cols.resize(stored);
+    A._vals.resize(stored);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        A._row[i+1] = A._row[i] + cursor[i].load(std::memory_order_relaxed);
+        cursor[i].store(A._row[i], std::memory_order_relaxed);
+    }
+
+    // Pass 2: scatter the entries into their rows
+    detail::for_each_chunk(threads, [&](unsigned t)
+    {
+        detail::parse_market_entries(chunks[t], chunks[t+1], header,
+        [&](unsigned i, unsigned j, double value)
+        {
+            const unsigned k = cursor[i].fetch_add(1, std::memory_order_relaxed);
+            A._cols[k] = j;
+            A._vals[k] = value;
+        });
+    });
+
+    // Entries may appear in any order, sort each row by column and sum
+    // repeated coordinates into one entry. Duplicates are ordered by value
+    // first so the sum does not depend on how the threads interleaved.
+    std::vector<unsigned> kept(n);
+    detail::for_each_chunk(threads, [&](unsigned t)
+    {
+        std::vector<std::pair<unsigned, double>> row;
+        for (unsigned i = (n * static_cast<unsigned long long>(t)) / threads;
+                      i < (n * static_cast<unsigned long long>(t + 1)) / threads; ++i)
+        {
+            const unsigned first = A._row[i];
+            const unsigned last  = A._row[i+1];
+
+            if (std::adjacent_find(A._cols.begin() + first, A._cols.begin() + last,
+                                   std::greater_equal<unsigned>()) == A._cols.begin() + last)
+            {
+                kept[i] = last - first;
+                continue;
+            }
+            row.clear();
+            for (unsigned k = first; k < last; ++k)
+            {
+                row.emplace_back(A._cols[k], A._vals[k]);
+            }
+            std::sort(row.begin(), row.end());
+
+            unsigned out = first;
+            for (unsigned r = 0; r < row.size(); ++r)
+            {
+                if (r > 0 && row[r].first == row[r-1].first)
+                {
+                    A._vals[out - 1] += row[r].second;
+                    continue;
+                }
+                A._cols[out] = row[r].first;
+                A._vals[out] = row[r].second;
+                ++out;
+            }
+            kept[i] = out - first;
+        }
+    });
+
+    // Close the gaps left by merged duplicates, entries only move left
+    if (std::accumulate(kept.begin(), kept.end(), 0ull) != stored)
+    {
+        unsigned out = 0;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            const unsigned first = A._row[i];
+            std::copy(A._cols.begin() + first, A._cols.begin() + first + kept[i], A._cols.begin() + out);
+            std::copy(A._vals.begin() + first, A._vals.begin() + first + kept[i], A._vals.begin() + out);
+
+            A._row[i] = out;
+            out += kept[i];
+        }
+        A._row[n] = out;
+        A._cols.resize(out);
+        A._vals.resize(out);
+        A._cols.shrink_to_fit();
+        A._vals.shrink_to_fit();
+    }
+
+    return A;
+}
+
+/* Writes A as a general real Matrix Market coordinate file with one based indices */
+template <unsigned n, unsigned m>
+void write_matrix_market(const std::string& path, const CSRMatrix<n,m>& A)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) { throw std::runtime_error("Unable to open " + path + " for writing"); }
+
+    file << "%%MatrixMarket matrix coordinate real general\n"
+         << n << ' ' << m << ' ' << A.nnz() << '\n';
+
+    // Format into a fixed buffer, one entry needs at most ~50 bytes
+    constexpr std::size_t capacity = 1 << 16;
+    constexpr std::size_t max_line = 64;
+    std::vector<char> buffer(capacity);
+    char* out = buffer.data();
+
+    for (unsigned i = 0; i < n; ++i)
+    {
+        for (unsigned k = A._row[i]; k < A._row[i+1]; ++k)
+        {
+            if (out + max_line > buffer.data() + capacity)
+            {
+                file.write(buffer.data(), out - buffer.data());
+                out = buffer.data();
+            }
+            char* const limit = buffer.data() + capacity;
+            out = std::to_chars(out, limit, i + 1).ptr;
+            *out++ = ' ';
+            out = std::to_chars(out, limit, A._cols[k] + 1).ptr;
+            *out++ = ' ';
+            out = std::to_chars(out, limit, A._vals[k]).ptr;
+            *out++ = '\n';
+        }
+    }
+    file.write(buffer.data(), out - buffer.data());
+
+    if (!file) { throw std::runtime_error("Failed writing matrix to " + path); }
+}
+
+#endif // MATRIX_MARKET_CPP_H
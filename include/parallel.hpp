@@ -0,0 +1,186 @@
+/*
+
+File: parallel.hpp
+
+Brief: Minimal fork-join helpers shared by the threaded kernels
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#ifndef PARALLEL_CPP_H
+#define PARALLEL_CPP_H
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace detail
+{
+
+// Runs task(chunk) on one thread per chunk and rethrows the first failure
+template <typename Task>
+void for_each_chunk(unsigned chunks, Task&& task)
+{
+    if (chunks <= 1)
+    {
+        task(0u);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(chunks);
+    auto guarded = [&](unsigned t)
+    {
+        try { task(t); }
+        catch (...) { errors[t] = std::current_exception(); }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < chunks; ++t)
+    {
+        pool.emplace_back(guarded, t);
+    }
+    guarded(0);
+
+    for (std::thread& thread : pool)
+    {
+        thread.join();
+    }
+    for (std::exception_ptr& error : errors)
+    {
+        if (error) { std::rethrow_exception(error); }
+    }
+}
+
+} // namespace detail
+
+/*
+ * Fixed set of worker threads for fork-join loops that run many times, such
+ * as the products inside an iterative solver, where starting threads per
+ * call would dominate. run() hands out chunk indices to the workers and the
+ * calling thread, and returns once every chunk has finished. A pool serves
+ * one run() at a time.
+ */
+class ThreadPool
+{
+public:
+
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Threads taking part in run(), including the caller
+    unsigned size() const noexcept { return _workers.size() + 1; }
+
+    void run(unsigned chunks, const std::function<void(unsigned)>& task);
+
+private:
+
+    void work();
+    void drain() noexcept;
+
+    std::vector<std::thread> _workers;
+
+    std::mutex              _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+
+    const std::function<void(unsigned)>* _task = nullptr;
+    std::exception_ptr    _error;
+    std::atomic<unsigned> _next { 0 };
+    unsigned _chunks     = 0;
+    unsigned _busy       = 0;
+    unsigned _generation = 0;
+    bool     _stop       = false;
+};
+
+inline ThreadPool::ThreadPool(unsigned threads)
+{
+    for (unsigned t = 1; t < threads; ++t)
+    {
+        _workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+inline ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+
+    for (std::thread& worker : _workers)
+    {
+        worker.join();
+    }
+}
+
+inline void ThreadPool::drain() noexcept
+{
+    for (unsigned t = _next++; t < _chunks; t = _next++)
+    {
+        try { (*_task)(t); }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_error) { _error = std::current_exception(); }
+        }
+    }
+}
+
+inline void ThreadPool::work()
+{
+    unsigned seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&] { return _stop || _generation != seen; });
+            if (_stop) { return; }
+            seen = _generation;
+        }
+
+        drain();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (--_busy == 0) { _done.notify_one(); }
+    }
+}
+
+inline void ThreadPool::run(unsigned chunks, const std::function<void(unsigned)>& task)
+{
+    if (_workers.empty() || chunks <= 1)
+    {
+        for (unsigned t = 0; t < chunks; ++t) { task(t); }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _task   = &task;
+        _chunks = chunks;
+        _busy   = _workers.size();
+        _error  = nullptr;
+        _next   = 0;
+        ++_generation;
+    }
+    _wake.notify_all();
+
+    drain();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [&] { return _busy == 0; });
+
+    if (_error) { std::rethrow_exception(_error); }
+}
+
+#endif // PARALLEL_CPP_H
@@ -0,0 +1,342 @@
+/*
+
+File: reordering.hpp
+
+Brief: Bandwidth reducing orderings and nnz-balanced partitions for CSR matrices
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#ifndef REORDERING_CPP_H
+#define REORDERING_CPP_H
+
+#include <vector>
+#include <numeric>
+#include <stdexcept>
+#include <algorithm>
+
+#include <fmatrix.hpp>
+#include <csr_matrix.hpp>
+
+/*
+ * A symmetric permutation of the indices 0..n-1. Row and column i of the
+ * reordered matrix are row and column _perm[i] of the original matrix.
+ */
+template <unsigned n>
+class Permutation
+{
+public:
+
+    Permutation();
+    Permutation(std::vector<unsigned> perm);
+
+    Permutation<n> inverse() const { return Permutation<n>(_iperm); }
+
+    std::vector<unsigned> _perm;  // _perm[new]  ==> old index
+    std::vector<unsigned> _iperm; // _iperm[old] ==> new index
+};
+
+template <unsigned n>
+Permutation<n>::Permutation()
+    : _perm(n), _iperm(n)
+{
+    std::iota(_perm.begin(), _perm.end(), 0);
+    std::iota(_iperm.begin(), _iperm.end(), 0);
+}
+
+template <unsigned n>
+Permutation<n>::Permutation(std::vector<unsigned> perm)
+    : _perm(std::move(perm)), _iperm(n, n)
+{
+    if (_perm.size() != n) { throw std::invalid_argument("Permutation has the wrong length"); }
+
+    for (unsigned i = 0; i < n; ++i)
+    {
+        if (_perm[i] >= n || _iperm[_perm[i]] != n)
+        {
+            throw std::invalid_argument("Permutation indices must be unique and in range");
+        }
+        _iperm[_perm[i]] = i;
+    }
+}
+
+namespace detail
+{
+
+// Adjacency of the structurally symmetric graph of A + A^T without self loops
+template <unsigned n>
+void symmetric_adjacency(const CSRMatrix<n,n>& A, std::vector<unsigned>& ptr,
+                                                  std::vector<unsigned>& adj)
+{
+    ptr.assign(n + 1, 0);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        for (unsigned k = A._row[i]; k < A._row[i+1]; ++k)
+        {
+            if (A._cols[k] != i)
+            {
+                ++ptr[i + 1];
+                ++ptr[A._cols[k] + 1];
+            }
+        }
+    }
+    std::partial_sum(ptr.begin(), ptr.end(), ptr.begin());
+
+    adj.resize(ptr[n]);
+    std::vector<unsigned> next(ptr.begin(), ptr.end() - 1);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        for (unsigned k = A._row[i]; k < A._row[i+1]; ++k)
+        {
+            const unsigned j = A._cols[k];
+            if (j != i)
+            {
+                adj[next[i]++] = j;
+                adj[next[j]++] = i;
+            }
+        }
+    }
+
+    // Symmetric entries were inserted twice, compact each list in place
+    unsigned out = 0;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        auto first = adj.begin() + ptr[i];
+        auto last  = adj.begin() + ptr[i+1];
+        std::sort(first, last);
+        last = std::unique(first, last);
+
+        ptr[i] = out;
+        out = std::copy(first, last, adj.begin() + out) - adj.begin();
+    }
+    ptr[n] = out;
+    adj.resize(out);
+}
+
+// Breadth first search from root, returns the eccentricity of root and
+// leaves the final level in [first, last) of levels
+inline unsigned bfs_levels(unsigned root, const std::vector<unsigned>& ptr,
+                           const std::vector<unsigned>& adj, std::vector<unsigned>& stamp,
+                           unsigned mark, std::vector<unsigned>& levels,
+                           unsigned& first, unsigned& last)
+{
+    levels.clear();
+    levels.push_back(root);
+    stamp[root] = mark;
+
+    unsigned depth = 0;
+    first = 0;
+    last  = 1;
+    while (true)
+    {
+        for (unsigned q = first; q < last; ++q)
+        {
+            const unsigned v = levels[q];
+            for (unsigned k = ptr[v]; k < ptr[v+1]; ++k)
+            {
+                if (stamp[adj[k]] != mark)
+                {
+                    stamp[adj[k]] = mark;
+                    levels.push_back(adj[k]);
+                }
+            }
+        }
+        if (levels.size() == last) { return depth; }
+
+        first = last;
+        last  = levels.size();
+        ++depth;
+    }
+}
+
+} // namespace detail
+
+/* Largest distance |i - j| of any stored entry from the diagonal */
+template <unsigned n, unsigned m>
+unsigned bandwidth(const CSRMatrix<n,m>& A)
+{
+    unsigned band = 0;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        for (unsigned k = A._row[i]; k < A._row[i+1]; ++k)
+        {
+            const unsigned j = A._cols[k];
+            band = std::max(band, (i > j) ? i - j : j - i);
+        }
+    }
+    return band;
+}
+
+/*
+ * Reverse Cuthill-McKee ordering of the symmetrized pattern of A. Each
+ * connected component is started from a pseudo-peripheral vertex found with
+ * the George-Liu heuristic.
+ */
+template <unsigned n>
+Permutation<n> rcm_ordering(const CSRMatrix<n,n>& A)
+{
+    std::vector<unsigned> ptr, adj;
+    detail::symmetric_adjacency(A, ptr, adj);
+
+    auto degree = [&ptr](unsigned v) { return ptr[v+1] - ptr[v]; };
+
+    std::vector<unsigned> order;
+    order.reserve(n);
+
+    std::vector<bool>     visited(n, false);
+    std::vector<unsigned> stamp(n, 0);
+    std::vector<unsigned> levels;
+    std::vector<unsigned> neighbors;
+    unsigned mark = 0;
+
+    for (unsigned seed = 0; order.size() < n; ++seed)
+    {
+        if (visited[seed]) { continue; }
+
+        // The seed is the lowest numbered vertex of a new component, start
+        // the search from a vertex of minimum degree within the component
+        unsigned first = 0, last = 0;
+        detail::bfs_levels(seed, ptr, adj, stamp, ++mark, levels, first, last);
+
+        unsigned root = *std::min_element(levels.begin(), levels.end(),
+                        [&](unsigned a, unsigned b) { return degree(a) < degree(b); });
+
+        unsigned eccentricity = detail::bfs_levels(root, ptr, adj, stamp, ++mark,
+                                                   levels, first, last);
+        while (true)
+        {
+            unsigned candidate = *std::min_element(levels.begin() + first, levels.begin() + last,
+                                 [&](unsigned a, unsigned b) { return degree(a) < degree(b); });
+
+            unsigned candidate_ecc = detail::bfs_levels(candidate, ptr, adj, stamp, ++mark,
+                                                        levels, first, last);
+            if (candidate_ecc <= eccentricity) { break; }
+
+            root = candidate;
+            eccentricity = candidate_ecc;
+        }
+
+        // Cuthill-McKee: breadth first, neighbors visited in increasing degree
+        unsigned head = order.size();
+        order.push_back(root);
+        visited[root] = true;
+        while (head < order.size())
+        {
+            const unsigned v = order[head++];
+
+            neighbors.clear();
+            for (unsigned k = ptr[v]; k < ptr[v+1]; ++k)
+            {
+                if (!visited[adj[k]])
+                {
+                    visited[adj[k]] = true;
+                    neighbors.push_back(adj[k]);
+                }
+            }
+            std::stable_sort(neighbors.begin(), neighbors.end(),
+                            [&](unsigned a, unsigned b) { return degree(a) < degree(b); });
+            order.insert(order.end(), neighbors.begin(), neighbors.end());
+        }
+    }
+
+    std::reverse(order.begin(), order.end());
+    return Permutation<n>(std::move(order));
+}
+
+/* Orders rows by increasing number of stored entries, ties keep their order */
+template <unsigned n>
+Permutation<n> degree_ordering(const CSRMatrix<n,n>& A)
+{
+    std::vector<unsigned> order(n);
+    std::iota(order.begin(), order.end(), 0);
+
+    std::stable_sort(order.begin(), order.end(), [&A](unsigned a, unsigned b)
+    {
+        return A._row[a+1] - A._row[a] < A._row[b+1] - A._row[b];
+    });
+    return Permutation<n>(std::move(order));
+}
+
+/* Applies the symmetric permutation P A P^T */
+template <unsigned n>
+CSRMatrix<n,n> permute(const CSRMatrix<n,n>& A, const Permutation<n>& P)
+{
+    CSRMatrix<n,n> B;
+    B._vals.resize(A.nnz());
+    B._cols.resize(A.nnz());
+
+    std::vector<std::pair<unsigned, double>> row;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        const unsigned old = P._perm[i];
+
+        row.clear();
+        for (unsigned k = A._row[old]; k < A._row[old+1]; ++k)
+        {
+            row.emplace_back(P._iperm[A._cols[k]], A._vals[k]);
+        }
+        std::sort(row.begin(), row.end(), [](const auto& a, const auto& b)
+        {
+            return a.first < b.first;
+        });
+
+        unsigned k = B._row[i];
+        for (const auto& entry : row)
+        {
+            B._cols[k] = entry.first;
+            B._vals[k] = entry.second;
+            ++k;
+        }
+        B._row[i+1] = k;
+    }
+    return B;
+}
+
+/* Moves row _perm[i] of X to row i, use on vectors entering the reordered system */
+template <unsigned n, unsigned p>
+FMatrix<n,p> permute(const FMatrix<n,p>& X, const Permutation<n>& P)
+{
+    FMatrix<n,p> Y;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        std::copy(X[P._perm[i]], X[P._perm[i]] + p, Y[i]);
+    }
+    return Y;
+}
+
+/* Inverse of permute, use on vectors leaving the reordered system */
+template <unsigned n, unsigned p>
+FMatrix<n,p> unpermute(const FMatrix<n,p>& Y, const Permutation<n>& P)
+{
+    FMatrix<n,p> X;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        std::copy(Y[i], Y[i] + p, X[P._perm[i]]);
+    }
+    return X;
+}
+
+/*
+ * Splits the rows of A into parts contiguous ranges holding roughly equal
+ * numbers of nonzeros. Range t is [bounds[t], bounds[t+1]).
+ */
+template <unsigned n, unsigned m>
+std::vector<unsigned> nnz_partition(const CSRMatrix<n,m>& A, unsigned parts)
+{
+    parts = std::max(1u, parts);
+
+    std::vector<unsigned> bounds(parts + 1, n);
+    bounds[0] = 0;
+    for (unsigned t = 1; t < parts; ++t)
+    {
+        const unsigned long long target = (static_cast<unsigned long long>(A.nnz()) * t) / parts;
+        bounds[t] = std::lower_bound(A._row, A._row + n + 1, target) - A._row;
+        bounds[t] = std::max(bounds[t], bounds[t-1]);
+    }
+    return bounds;
+}
+
+#endif // REORDERING_CPP_H
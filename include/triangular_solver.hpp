@@ -0,0 +1,273 @@
+/*
+
+File: triangular_solver.hpp
+
+Brief: Level-scheduled sparse triangular solver for CSR matrices
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#ifndef TRIANGULAR_SOLVER_CPP_H
+#define TRIANGULAR_SOLVER_CPP_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <numeric>
+#include <stdexcept>
+#include <algorithm>
+
+#include <fmatrix.hpp>
+#include <parallel.hpp>
+#include <csr_matrix.hpp>
+
+enum class Triangle { Lower, Upper };
+enum class Diagonal { NonUnit, Unit };
+
+namespace detail
+{
+
+// Reusable spinning barrier, the solve phase crosses one per level
+class SpinBarrier
+{
+public:
+
+    explicit SpinBarrier(unsigned count) : _count(count) {}
+
+    void arrive_and_wait() noexcept
+    {
+        const unsigned generation = _generation.load(std::memory_order_acquire);
+        if (_waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == _count)
+        {
+            _waiting.store(0, std::memory_order_relaxed);
+            _generation.fetch_add(1, std::memory_order_acq_rel);
+            return;
+        }
+        while (_generation.load(std::memory_order_acquire) == generation)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+
+    const unsigned        _count;
+    std::atomic<unsigned> _waiting    { 0 };
+    std::atomic<unsigned> _generation { 0 };
+};
+
+} // namespace detail
+
+/*
+ * Solves Tx = B where T is the lower or upper triangle of a square CSR matrix.
+ * Entries outside of the selected triangle are ignored, so the L and U
+ * factors of an incomplete factorization can share one matrix.
+ *
+ * Construction (or analyze()) performs the analysis phase: every row is
+ * assigned a level one greater than the deepest row it depends on. Rows
+ * within a level are independent and are solved concurrently on the workers
+ * of a ThreadPool, which cross a barrier between levels. The schedule
+ * depends only on the sparsity pattern, so it can be reused across any number
+ * of solves with matrices that share that pattern. The analyzed pattern is
+ * kept and every solve checks the matrix against it.
+ */
+template <unsigned n>
+class TriangularSolver
+{
+public:
+
+    TriangularSolver() = default;
+    TriangularSolver(const CSRMatrix<n,n>& T, Triangle uplo,
+                     Diagonal diag = Diagonal::NonUnit);
+
+    void analyze(const CSRMatrix<n,n>& T, Triangle uplo,
+                 Diagonal diag = Diagonal::NonUnit);
+
+    unsigned levels() const noexcept { return _level.empty() ? 0 : _level.size() - 1; }
+
+    // Solves on the calling thread alone when pool is null
+    template <unsigned p>
+    FMatrix<n, p> solve(const CSRMatrix<n,n>& T, const FMatrix<n, p>& B,
+                        ThreadPool* pool = nullptr) const;
+
+    Triangle _uplo = Triangle::Lower;
+    Diagonal _diag = Diagonal::NonUnit;
+
+    std::vector<unsigned> _row;        // Sparsity pattern the schedule was built from
+    std::vector<unsigned> _cols;
+
+    std::vector<unsigned> _level;      // _level[l] ==> start of level l in _order
+    std::vector<unsigned> _order;      // Rows grouped by level
+    std::vector<unsigned> _diag_index; // Position of T[i][i] in _vals
+
+private:
+
+    bool same_pattern(const CSRMatrix<n,n>& T) const noexcept;
+
+    template <unsigned p>
+    void solve_row(const CSRMatrix<n,n>& T, unsigned i, FMatrix<n, p>& X) const;
+};
+
+template <unsigned n>
+TriangularSolver<n>::TriangularSolver(const CSRMatrix<n,n>& T, Triangle uplo, Diagonal diag)
+{
+    analyze(T, uplo, diag);
+}
+
+template <unsigned n>
+void TriangularSolver<n>::analyze(const CSRMatrix<n,n>& T, Triangle uplo, Diagonal diag)
+{
+    _uplo = uplo;
+    _diag = diag;
+    _row.assign(T._row, T._row + n + 1);
+    _cols.assign(T._cols.begin(), T._cols.end());
+    _diag_index.assign(n, T.nnz());
+
+    // Depth of each row in the dependency DAG, rows are visited in the order
+    // a sequential solve would visit them so dependencies are always resolved
+    std::vector<unsigned> depth(n, 0);
+    unsigned max_depth = 0;
+
+    for (unsigned r = 0; r < n; ++r)
+    {
+        const unsigned i = (uplo == Triangle::Lower) ? r : n - 1 - r;
+
+        unsigned d = 0;
+        for (unsigned k = T._row[i]; k < T._row[i+1]; ++k)
+        {
+            const unsigned j = T._cols[k];
+            if (j == i)
+            {
+                _diag_index[i] = k;
+            }
+            else if ((uplo == Triangle::Lower) ? j < i : j > i)
+            {
+                d = std::max(d, depth[j] + 1);
+            }
+        }
+        if (diag == Diagonal::NonUnit &&
+           (_diag_index[i] == T.nnz() || T._vals[_diag_index[i]] == 0))
+        {
+            throw std::domain_error("Triangular matrix has a zero on the diagonal");
+        }
+        depth[i]  = d;
+        max_depth = std::max(max_depth, d);
+    }
+
+    // Counting sort of the rows by level
+    _level.assign(max_depth + 2, 0);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        ++_level[depth[i] + 1];
+    }
+    std::partial_sum(_level.begin(), _level.end(), _level.begin());
+
+    _order.resize(n);
+    std::vector<unsigned> next(_level.begin(), _level.end() - 1);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        _order[next[depth[i]]++] = i;
+    }
+}
+
+template <unsigned n>
+bool TriangularSolver<n>::same_pattern(const CSRMatrix<n,n>& T) const noexcept
+{
+    return _row.size() == n + 1
+        && std::equal(_row.begin(), _row.end(), T._row)
+        && std::equal(_cols.begin(), _cols.end(), T._cols.begin(), T._cols.end());
+}
+
+template <unsigned n>
+template <unsigned p>
+void TriangularSolver<n>::solve_row(const CSRMatrix<n,n>& T, unsigned i, FMatrix<n, p>& X) const
+{
+    double* x = X[i];
+    for (unsigned k = T._row[i]; k < T._row[i+1]; ++k)
+    {
+        const unsigned j = T._cols[k];
+        if ((_uplo == Triangle::Lower) ? j < i : j > i)
+        {
+            const double  a  = T._vals[k];
+            const double* xj = X[j];
+            for (unsigned c = 0; c < p; ++c)
+            {
+                x[c] -= a * xj[c];
+            }
+        }
+    }
+    if (_diag == Diagonal::NonUnit)
+    {
+        const double d = T._vals[_diag_index[i]];
+        for (unsigned c = 0; c < p; ++c)
+        {
+            x[c] /= d;
+        }
+    }
+}
+
+template <unsigned n>
+template <unsigned p>
+FMatrix<n, p> TriangularSolver<n>::solve(const CSRMatrix<n,n>& T, const FMatrix<n, p>& B,
+                                         ThreadPool* pool) const
+{
+    if (!same_pattern(T))
+    {
+        throw std::invalid_argument("Matrix does not match the analyzed sparsity pattern");
+    }
+    if (_diag == Diagonal::NonUnit)
+    {
+        // Values may have changed since the analysis
+        for (unsigned i = 0; i < n; ++i)
+        {
+            if (T._vals[_diag_index[i]] == 0)
+            {
+                throw std::domain_error("Triangular matrix has a zero on the diagonal");
+            }
+        }
+    }
+
+    FMatrix<n, p> X(B);
+
+    unsigned widest = 0;
+    for (unsigned l = 0; l < levels(); ++l)
+    {
+        widest = std::max(widest, _level[l+1] - _level[l]);
+    }
+    const unsigned threads = pool ? std::max(1u, std::min(pool->size(), widest)) : 1;
+
+    if (threads == 1)
+    {
+        for (unsigned i : _order)
+        {
+            solve_row(T, i, X);
+        }
+        return X;
+    }
+
+    // One chunk per thread, so every chunk runs concurrently and can wait at
+    // the barrier for the others
+    detail::SpinBarrier barrier(threads);
+
+    pool->run(threads, [&](unsigned t)
+    {
+        for (unsigned l = 0; l < levels(); ++l)
+        {
+            const unsigned width = _level[l+1] - _level[l];
+            const unsigned begin = _level[l] + (width * t) / threads;
+            const unsigned end   = _level[l] + (width * (t + 1)) / threads;
+
+            for (unsigned r = begin; r < end; ++r)
+            {
+                solve_row(T, _order[r], X);
+            }
+            barrier.arrive_and_wait();
+        }
+    });
+    return X;
+}
+
+#endif // TRIANGULAR_SOLVER_CPP_H
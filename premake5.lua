@@ -23,6 +23,25 @@ workspace "Matrix-CPP"
 
     -- PLATFORM CONFIGURATIONS --
 
+    -- BUILD OPTIONS --
+    newoption {
+        trigger     = "instrument",
+        description = "Record per-kernel call counts, timings and FLOP/byte totals"
+    }
+
+    newoption {
+        trigger     = "perf-events",
+        description = "Also read Linux perf_event hardware counters (needs --instrument)"
+    }
+
+    filter "options:instrument"
+        defines { "MATRIX_CPP_INSTRUMENT" }
+
+    filter "options:perf-events"
+        defines { "MATRIX_CPP_PERF_EVENTS" }
+
+    filter {} -- close filter
+
     -- COMPILER/LINKER CONFIG --
     flags "FatalWarnings"
     warnings "Extra"
@@ -39,8 +58,9 @@ workspace "Matrix-CPP"
 
     filter "toolset:gcc"
         buildoptions { 
-            "-Wall", "-Wextra", "-Werror", "-std=c++17"
+            "-Wall", "-Wextra", "-Werror", "-std=c++17", "-pthread"
         }
+        linkoptions { "-pthread" }
 
     filter {} -- close filter
 
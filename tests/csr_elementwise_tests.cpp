@@ -0,0 +1,156 @@
+/*
+
+File: csr_elementwise_tests.cpp
+
+Brief: Unit tests for elementwise operations between CSR matrices
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#include <catch.hpp>
+#include <fmatrix.hpp>
+#include <csr_matrix.hpp>
+#include <csr_elementwise.hpp>
+
+TEST_CASE("CSR addition and subtraction", "[addition], [csr_elementwise]")
+{
+    FMatrix<3, 4> A { 1, 0, 2, 0
+                    , 0, 0, 0, 0
+                    , 0, 3, 0, 4 };
+
+    FMatrix<3, 4> B { 0, 5, 2, 0
+                    , 0, 0, 6, 0
+                    , 0, 0, 0, 1 };
+
+    CSRMatrix<3, 4> CSR_A(A);
+    CSRMatrix<3, 4> CSR_B(B);
+
+    SECTION("Sparse addition matches dense addition")
+    {
+        REQUIRE((CSR_A + CSR_B).to_fmatrix() == A + B);
+    }
+    SECTION("Sparse subtraction matches dense subtraction")
+    {
+        REQUIRE((CSR_A - CSR_B).to_fmatrix() == A + B * -1);
+    }
+    SECTION("The symbolic pass sizes the union exactly")
+    {
+        REQUIRE(elementwise_symbolic(CSR_A, CSR_B, SparsityMerge::Union).nnz() == 6);
+        REQUIRE(elementwise_symbolic(CSR_A, CSR_B, SparsityMerge::Intersection).nnz() == 2);
+    }
+    SECTION("Cancelling entries stay in the pattern as explicit zeros")
+    {
+        CSRMatrix<3, 4> zero = CSR_A - CSR_A;
+
+        REQUIRE(zero.nnz() == CSR_A.nnz());
+        REQUIRE(zero.to_fmatrix() == FMatrix<3, 4>());
+    }
+    SECTION("Pruning drops the explicit zeros")
+    {
+        CSRMatrix<3, 4> diff = CSR_A - CSR_B;
+
+        REQUIRE(prune(diff) == CSRMatrix<3, 4>(A + B * -1));
+
+        CSRMatrix<3, 4> zero = CSR_A - CSR_A;
+
+        REQUIRE(zero != CSRMatrix<3, 4>());
+        REQUIRE(prune(zero) == CSRMatrix<3, 4>());
+        REQUIRE(zero.nnz() == 0);
+    }
+    SECTION("Threaded addition matches sequential addition")
+    {
+        REQUIRE(add(CSR_A, CSR_B, 4) == add(CSR_A, CSR_B));
+        REQUIRE(subtract(CSR_A, CSR_B, 2) == subtract(CSR_A, CSR_B));
+    }
+}
+
+TEST_CASE("CSR Hadamard and masked products", "[hadamard], [csr_elementwise]")
+{
+    FMatrix<3, 3> A { 1, 2, 0
+                    , 0, 3, 4
+                    , 5, 0, 6 };
+
+    FMatrix<3, 3> B { 2, 0, 1
+                    , 0, 2, 2
+                    , 1, 1, 0 };
+
+    FMatrix<3, 3> AB { 2, 0, 0
+                     , 0, 6, 8
+                     , 5, 0, 0 };
+
+    CSRMatrix<3, 3> CSR_A(A);
+    CSRMatrix<3, 3> CSR_B(B);
+
+    SECTION("Hadamard products keep the intersection")
+    {
+        REQUIRE(hadamard(CSR_A, CSR_B) == CSRMatrix<3, 3>(AB));
+        REQUIRE(hadamard(CSR_A, CSR_B, 3) == CSRMatrix<3, 3>(AB));
+    }
+    SECTION("Masking selects entries by pattern")
+    {
+        CSRMatrix<3, 3> M { 0, 9, 0
+                          , 0, 0, 9
+                          , 9, 9, 0 };
+
+        FMatrix<3, 3> masked { 0, 2, 0
+                             , 0, 0, 4
+                             , 5, 0, 0 };
+
+        REQUIRE(mask(CSR_A, M) == CSRMatrix<3, 3>(masked));
+    }
+    SECTION("Masked Hadamard products skip entries outside the mask")
+    {
+        CSRMatrix<3, 3> M { 1, 0, 0
+                          , 0, 0, 1
+                          , 0, 1, 0 };
+
+        FMatrix<3, 3> expected { 2, 0, 0
+                               , 0, 0, 8
+                               , 0, 0, 0 };
+
+        REQUIRE(masked_hadamard(CSR_A, CSR_B, M).to_fmatrix() == expected);
+    }
+}
+
+TEST_CASE("Reusing elementwise patterns", "[numeric], [csr_elementwise]")
+{
+    CSRMatrix<3, 3> A { 1, 2, 0
+                      , 0, 3, 4
+                      , 5, 0, 6 };
+
+    CSRMatrix<3, 3> B { 2, 0, 1
+                      , 0, 2, 2
+                      , 1, 1, 0 };
+
+    SECTION("The numeric pass refills an existing pattern with new values")
+    {
+        CSRMatrix<3, 3> C = elementwise_symbolic(A, B, SparsityMerge::Union);
+
+        elementwise_numeric(C, A, B, std::plus<double>());
+        REQUIRE(C == A + B);
+
+        elementwise_numeric(C, A * 2, B * 3, std::plus<double>(), 2);
+        REQUIRE(C.to_fmatrix() == (A * 2).to_fmatrix() + (B * 3).to_fmatrix());
+    }
+    SECTION("Identical patterns combine value arrays directly")
+    {
+        CSRMatrix<3, 3> sum = A + A * 2;
+
+        REQUIRE(sum._cols == A._cols);
+        REQUIRE(sum == A * 3);
+    }
+    SECTION("Identical patterns split the value arrays across threads")
+    {
+        CSRMatrix<3, 3> C = elementwise_symbolic(A, A, SparsityMerge::Union);
+
+        elementwise_numeric(C, A, A * 2, std::plus<double>(), 4);
+        REQUIRE(C == A * 3);
+
+        elementwise_numeric(C, A, A, std::minus<double>(), 64);
+        REQUIRE(C.nnz() == A.nnz());
+        REQUIRE(C.to_fmatrix() == FMatrix<3, 3>());
+    }
+}
@@ -0,0 +1,134 @@
+/*
+
+File: dynamic_csr_matrix_tests.cpp
+
+Brief: Unit tests for the incrementally updatable CSR matrix
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#include <catch.hpp>
+#include <fmatrix.hpp>
+#include <csr_matrix.hpp>
+#include <dynamic_csr_matrix.hpp>
+
+TEST_CASE("Updating a dynamic CSR matrix", "[updates], [dynamic_csr_matrix]")
+{
+    CSRMatrix<3, 4> base { 1, 0, 2, 0
+                         , 0, 0, 0, 0
+                         , 0, 3, 0, 4 };
+
+    // A ratio large enough that no update triggers a compaction
+    DynamicCSRMatrix<3, 4> A(base, 10.0);
+
+    SECTION("Reads see the base entries")
+    {
+        REQUIRE(A.at(0, 2) == 2);
+        REQUIRE(A.at(1, 1) == 0);
+        REQUIRE(A.contains(2, 3));
+        REQUIRE_FALSE(A.contains(2, 2));
+        REQUIRE(A.nnz() == 4);
+    }
+    SECTION("Updating a stored entry does not change the structure")
+    {
+        A.set(2, 1, 30);
+
+        REQUIRE(A.at(2, 1) == 30);
+        REQUIRE(A.pending() == 0);
+    }
+    SECTION("Inserting new entries")
+    {
+        A.set(1, 3, 5);
+        A.set(1, 0, 6);
+
+        REQUIRE(A.at(1, 3) == 5);
+        REQUIRE(A.at(1, 0) == 6);
+        REQUIRE(A.nnz() == 6);
+        REQUIRE(A.pending() == 2);
+    }
+    SECTION("Erasing base and inserted entries")
+    {
+        A.set(1, 3, 5);
+
+        REQUIRE(A.erase(0, 0));
+        REQUIRE(A.erase(1, 3));
+        REQUIRE_FALSE(A.erase(0, 0));
+        REQUIRE_FALSE(A.erase(1, 1));
+
+        REQUIRE_FALSE(A.contains(0, 0));
+        REQUIRE(A.at(0, 0) == 0);
+        REQUIRE(A.nnz() == 3);
+    }
+    SECTION("Setting an erased entry restores it")
+    {
+        A.erase(0, 0);
+        A.set(0, 0, 7);
+
+        REQUIRE(A.contains(0, 0));
+        REQUIRE(A.at(0, 0) == 7);
+        REQUIRE(A.nnz() == 4);
+    }
+    SECTION("Out of range updates throw")
+    {
+        REQUIRE_THROWS_AS(A.set(3, 0, 1), std::out_of_range);
+        REQUIRE_THROWS_AS(A.erase(0, 4), std::out_of_range);
+        REQUIRE_THROWS_AS(A.at(5, 5), std::out_of_range);
+    }
+}
+
+TEST_CASE("Dynamic CSR products and compaction", "[compaction], [dynamic_csr_matrix]")
+{
+    CSRMatrix<3, 4> base { 1, 0, 2, 0
+                         , 0, 0, 0, 0
+                         , 0, 3, 0, 4 };
+
+    FMatrix<3, 4> expected { 0, 0, 2, 0
+                           , 6, 0, 0, 5
+                           , 0, 3, 8, 4 };
+
+    FMatrix<4, 2> B { 1, 2
+                    , 3, 4
+                    , 5, 6
+                    , 7, 8 };
+
+    DynamicCSRMatrix<3, 4> A(base, 10.0);
+    A.erase(0, 0);
+    A.set(1, 3, 5);
+    A.set(1, 0, 6);
+    A.set(2, 2, 8);
+
+    SECTION("Products merge the base and delta")
+    {
+        REQUIRE(A.to_fmatrix() == expected);
+        REQUIRE(A * B == expected * B);
+        REQUIRE(A * B.view() == expected * B);
+    }
+    SECTION("Merged CSR matches a rebuild from scratch")
+    {
+        REQUIRE(A.to_csr() == CSRMatrix<3, 4>(expected));
+    }
+    SECTION("Compaction folds the deltas into the base")
+    {
+        A.compact();
+
+        REQUIRE(A.pending() == 0);
+        REQUIRE(A._base == CSRMatrix<3, 4>(expected));
+        REQUIRE(A * B == expected * B);
+    }
+    SECTION("Exceeding the compaction ratio compacts automatically")
+    {
+        DynamicCSRMatrix<3, 4> B(base, 0.5);
+
+        B.set(1, 1, 1);
+        B.set(1, 2, 1);
+        REQUIRE(B.pending() == 2);
+
+        B.set(0, 1, 1);
+        REQUIRE(B.pending() == 0);
+        REQUIRE(B.nnz() == 7);
+        REQUIRE(B.at(1, 2) == 1);
+    }
+}
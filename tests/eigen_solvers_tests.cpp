@@ -0,0 +1,209 @@
+/*
+
+File: eigen_solvers_tests.cpp
+
+Brief: Unit tests for the iterative sparse eigensolvers
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#include <cmath>
+#include <catch.hpp>
+#include <fmatrix.hpp>
+#include <parallel.hpp>
+#include <csr_matrix.hpp>
+#include <eigen_solvers.hpp>
+
+// The 1D Laplacian tridiag(-1, 2, -1) has eigenvalues 2 - 2cos(j pi / (n + 1))
+template <unsigned n>
+static CSRMatrix<n,n> laplacian()
+{
+    FMatrix<n,n> L;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        L[i][i] = 2;
+        if (i > 0)     { L[i][i-1] = -1; }
+        if (i + 1 < n) { L[i][i+1] = -1; }
+    }
+    return CSRMatrix<n,n>(L);
+}
+
+static double laplacian_eigenvalue(unsigned j, unsigned n)
+{
+    return 2 - 2 * std::cos(j * M_PI / (n + 1));
+}
+
+// Largest residual norm ||A v - l v|| over the returned pairs
+template <unsigned n, unsigned k>
+static double max_residual(const CSRMatrix<n,n>& A, const EigenResult<n,k>& result)
+{
+    FMatrix<n,k> AV = A * result.vectors;
+
+    double worst = 0;
+    for (unsigned c = 0; c < k; ++c)
+    {
+        double sum = 0;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            const double r = AV[i][c] - result.values[c] * result.vectors[i][c];
+            sum += r * r;
+        }
+        worst = std::max(worst, std::sqrt(sum));
+    }
+    return worst;
+}
+
+TEST_CASE("Power iteration", "[power], [eigen_solvers]")
+{
+    CSRMatrix<4,4> A { 10, 1, 0, 0
+                     ,  1, 3, 1, 0
+                     ,  0, 1, 2, 1
+                     ,  0, 0, 1, 1 };
+
+    EigenOptions options;
+    options.tolerance = 1e-10;
+
+    EigenResult<4,1> result = power_iteration(A, options);
+
+    SECTION("Power iteration converges to the dominant eigenpair")
+    {
+        REQUIRE(result.converged);
+        REQUIRE(result.values[0] > 10);
+        REQUIRE(max_residual(A, result) < 1e-8);
+    }
+    SECTION("Power iteration agrees with Lanczos")
+    {
+        REQUIRE(result.values[0] == Approx(lanczos<1>(A).values[0]).epsilon(1e-8));
+    }
+}
+
+TEST_CASE("Lanczos iteration", "[lanczos], [eigen_solvers]")
+{
+    constexpr unsigned n = 40;
+    CSRMatrix<n,n> L = laplacian<n>();
+
+    SECTION("Largest eigenpairs of the Laplacian")
+    {
+        EigenResult<n,3> result = lanczos<3>(L);
+
+        REQUIRE(result.converged);
+        for (unsigned c = 0; c < 3; ++c)
+        {
+            REQUIRE(result.values[c] == Approx(laplacian_eigenvalue(n - c, n)).epsilon(1e-6));
+        }
+        REQUIRE(max_residual(L, result) < 1e-6);
+    }
+    SECTION("Smallest eigenpairs of the Laplacian")
+    {
+        EigenOptions options;
+        options.target = EigenTarget::Smallest;
+
+        EigenResult<n,2> result = lanczos<2>(L, options);
+
+        REQUIRE(result.values[0] == Approx(laplacian_eigenvalue(1, n)).epsilon(1e-6));
+        REQUIRE(result.values[1] == Approx(laplacian_eigenvalue(2, n)).epsilon(1e-6));
+    }
+    SECTION("Exhausted Krylov spaces restart for the remaining pairs")
+    {
+        CSRMatrix<4,4> I { 1, 0, 0, 0
+                         , 0, 1, 0, 0
+                         , 0, 0, 1, 0
+                         , 0, 0, 0, 1 };
+
+        EigenResult<4,2> result = lanczos<2>(I);
+
+        REQUIRE(result.converged);
+        REQUIRE(result.values[0] == Approx(1));
+        REQUIRE(result.values[1] == Approx(1));
+        REQUIRE(max_residual(I, result) < 1e-8);
+    }
+    SECTION("Repeated extreme eigenvalues are found once per copy")
+    {
+        // diag(1 + i % 5) holds every eigenvalue four times
+        FMatrix<20,20> dense;
+        for (unsigned i = 0; i < 20; ++i) { dense[i][i] = 1 + (i % 5); }
+        CSRMatrix<20,20> D(dense);
+
+        EigenResult<20,2> result = lanczos<2>(D);
+
+        // Converged by the residual test, not by spanning all of R^20
+        REQUIRE(result.converged);
+        REQUIRE(result.iterations < 20);
+        REQUIRE(result.values[0] == Approx(5));
+        REQUIRE(result.values[1] == Approx(5));
+        REQUIRE(max_residual(D, result) < 1e-6);
+
+        FMatrix<2,2> gram = result.vectors.transpose() * result.vectors;
+        REQUIRE(std::fabs(gram[0][1]) < 1e-6);
+    }
+}
+
+TEST_CASE("LOBPCG", "[lobpcg], [eigen_solvers]")
+{
+    constexpr unsigned n = 30;
+    CSRMatrix<n,n> L = laplacian<n>();
+
+    EigenOptions options;
+    options.tolerance = 1e-7;
+
+    SECTION("Largest eigenpairs of the Laplacian")
+    {
+        EigenResult<n,2> result = lobpcg<2>(L, options);
+
+        REQUIRE(result.converged);
+        REQUIRE(result.values[0] == Approx(laplacian_eigenvalue(n, n)).epsilon(1e-6));
+        REQUIRE(result.values[1] == Approx(laplacian_eigenvalue(n - 1, n)).epsilon(1e-6));
+        REQUIRE(max_residual(L, result) < 1e-5);
+    }
+    SECTION("Smallest eigenpairs of the Laplacian")
+    {
+        options.target = EigenTarget::Smallest;
+
+        EigenResult<n,2> result = lobpcg<2>(L, options);
+
+        REQUIRE(result.converged);
+        REQUIRE(result.values[0] == Approx(laplacian_eigenvalue(1, n)).epsilon(1e-6));
+        REQUIRE(result.values[1] == Approx(laplacian_eigenvalue(2, n)).epsilon(1e-6));
+    }
+    SECTION("Solving on a thread pool with a reused workspace")
+    {
+        ThreadPool pool(3);
+        EigenWorkspace workspace;
+        options.pool = &pool;
+
+        EigenResult<n,2> first  = lobpcg<2>(L, options, workspace);
+        EigenResult<n,2> second = lobpcg<2>(L, options, workspace);
+
+        REQUIRE(first.converged);
+        REQUIRE(first.values[0] == second.values[0]);
+        REQUIRE(first.values[0] == Approx(laplacian_eigenvalue(n, n)).epsilon(1e-6));
+    }
+}
+
+TEST_CASE("Thread pools", "[pool], [parallel]")
+{
+    ThreadPool pool(4);
+
+    SECTION("Every chunk runs exactly once")
+    {
+        std::vector<int> hits(100, 0);
+        pool.run(100, [&](unsigned t) { ++hits[t]; });
+
+        REQUIRE(std::count(hits.begin(), hits.end(), 1) == 100);
+    }
+    SECTION("Failures are rethrown on the caller")
+    {
+        REQUIRE_THROWS_AS(pool.run(8, [](unsigned t)
+        {
+            if (t == 5) { throw std::runtime_error("chunk failed"); }
+        }), std::runtime_error);
+
+        // The pool stays usable afterwards
+        unsigned count = 0;
+        pool.run(1, [&](unsigned) { ++count; });
+        REQUIRE(count == 1);
+    }
+}
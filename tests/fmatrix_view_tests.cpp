@@ -0,0 +1,156 @@
+/*
+
+File: fmatrix_view_tests.cpp
+
+Brief: Unit tests for non-owning flat matrix views
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#include <limits>
+#include <catch.hpp>
+#include <fmatrix.hpp>
+#include <csr_matrix.hpp>
+
+TEST_CASE("Slicing matrices into views", "[slicing], [fmatrix_view]")
+{
+    FMatrix<3, 4> A { 1,  2,  3,  4
+                    , 5,  6,  7,  8
+                    , 9, 10, 11, 12 };
+
+    SECTION("A full view aliases the matrix storage")
+    {
+        FMatrixView<3, 4> view = A.view();
+        view(1, 1) = 60;
+
+        REQUIRE(A[1][1] == 60);
+        REQUIRE(view.is_contiguous());
+    }
+    SECTION("Submatrix views are strided blocks")
+    {
+        FMatrix<2, 2> block { 6,  7
+                            , 10, 11 };
+
+        REQUIRE(A.submatrix<2, 2>(1, 1).to_fmatrix() == block);
+        REQUIRE_FALSE(A.submatrix<2, 2>(1, 1).is_contiguous());
+    }
+    SECTION("Row and column views")
+    {
+        RVector<4> row { 5, 6, 7, 8 };
+        CVector<3> col { 3, 7, 11 };
+
+        REQUIRE(A.row(1).to_fmatrix()    == row);
+        REQUIRE(A.column(2).to_fmatrix() == col);
+    }
+    SECTION("Row range views")
+    {
+        FMatrix<2, 4> rows { 5,  6,  7,  8
+                           , 9, 10, 11, 12 };
+
+        REQUIRE(A.view().rows<2>(1).to_fmatrix() == rows);
+    }
+    SECTION("Transposed views swap the strides")
+    {
+        REQUIRE(A.view().transpose().to_fmatrix() == A.transpose());
+        REQUIRE(A.view().transpose().transpose() == A.view());
+    }
+    SECTION("Views of views compose")
+    {
+        REQUIRE(A.submatrix<2, 3>(1, 1).column(1).at(1, 0) == 11);
+    }
+    SECTION("Out of range slices throw")
+    {
+        REQUIRE_THROWS_AS((A.submatrix<2, 2>(2, 0)), std::out_of_range);
+        REQUIRE_THROWS_AS((A.submatrix<2, 2>(std::numeric_limits<unsigned>::max(), 0)), std::out_of_range);
+        REQUIRE_THROWS_AS((A.submatrix<2, 2>(0, std::numeric_limits<unsigned>::max() - 1)), std::out_of_range);
+        REQUIRE_THROWS_AS(A.row(3), std::out_of_range);
+        REQUIRE_THROWS_AS(A.view().at(0, 4), std::out_of_range);
+    }
+}
+
+TEST_CASE("Arithmetic through views", "[arithmetic], [fmatrix_view]")
+{
+    FMatrix<3, 3> A { 1, 2, 3
+                    , 4, 5, 6
+                    , 7, 8, 9 };
+
+    SECTION("Adding into a block only touches the block")
+    {
+        FMatrix<2, 2> ones { 1, 1
+                           , 1, 1 };
+
+        A.submatrix<2, 2>(0, 0) += ones;
+
+        FMatrix<3, 3> expected { 2, 3, 3
+                               , 5, 6, 6
+                               , 7, 8, 9 };
+        REQUIRE(A == expected);
+    }
+    SECTION("Views combine with matrices directly")
+    {
+        FMatrix<2, 2> ones { 1, 1
+                           , 1, 1 };
+
+        FMatrix<2, 2> block { 6, 7
+                            , 9, 10 };
+
+        REQUIRE(A.submatrix<2, 2>(1, 1) + ones == block);
+        REQUIRE(A.submatrix<2, 2>(1, 1) != ones);
+        REQUIRE(2 * A.submatrix<2, 2>(1, 1) == A.submatrix<2, 2>(1, 1) * 2);
+
+        A.submatrix<2, 2>(0, 0).assign(ones);
+        REQUIRE(A.submatrix<2, 2>(0, 0) == ones);
+        REQUIRE(A.view() == A);
+    }
+    SECTION("Scaling a column in place")
+    {
+        A.column(0) *= 2;
+
+        CVector<3> expected { 2, 8, 14 };
+        REQUIRE(A.column(0).to_fmatrix() == expected);
+    }
+    SECTION("Matrices add views")
+    {
+        FMatrix<3, 3> expected { 2,  6, 10
+                               , 6, 10, 14
+                               , 10, 14, 18 };
+
+        REQUIRE(A + A.view().transpose() == expected);
+    }
+    SECTION("Multiplying by a transposed view matches multiplying by the transpose")
+    {
+        REQUIRE(A * A.view().transpose() == A * A.transpose());
+        REQUIRE(A.view().transpose() * A == A.transpose() * A);
+    }
+    SECTION("Multiplying blocks")
+    {
+        FMatrix<2, 2> expected { 1 * 5 + 2 * 8, 1 * 6 + 2 * 9
+                               , 4 * 5 + 5 * 8, 4 * 6 + 5 * 9 };
+
+        REQUIRE(A.submatrix<2, 2>(0, 0) * A.submatrix<2, 2>(1, 1) == expected);
+    }
+    SECTION("Multiplying into a block of another matrix")
+    {
+        FMatrix<4, 4> C;
+
+        multiply_into(C.submatrix<3, 3>(1, 1), A.view(), A.view());
+        REQUIRE(C.submatrix<3, 3>(1, 1).to_fmatrix() == A * A);
+        REQUIRE(C.row(0).to_fmatrix() == RVector<4>());
+
+        const FMatrix<3, 3>& constant = A;
+
+        multiply_add(C.submatrix<3, 3>(1, 1), constant.view(), A.submatrix<3, 3>(0, 0));
+        REQUIRE(C.submatrix<3, 3>(1, 1).to_fmatrix() == (A * A) * 2);
+    }
+    SECTION("Sparse matrices multiply views")
+    {
+        CSRMatrix<2, 3> S { 1, 0, 2
+                          , 0, 3, 0 };
+
+        REQUIRE(S * A.view().transpose() == S * A.transpose());
+        REQUIRE(S * A.column(1) == S * CVector<3> { 2, 5, 8 });
+    }
+}
@@ -0,0 +1,284 @@
+/*
+
+File: instrumentation_tests.cpp
+
+Brief: Unit tests for the kernel instrumentation registry and scopes
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <catch.hpp>
+#include <fmatrix.hpp>
+#include <parallel.hpp>
+#include <csr_matrix.hpp>
+#include <matrix_file.hpp>
+#include <eigen_solvers.hpp>
+#include <instrumentation.hpp>
+
+TEST_CASE("Recording kernel scopes", "[scopes], [instrumentation]")
+{
+    KernelRegistry registry;
+
+    SECTION("Each scope records one call with its work")
+    {
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            KernelScope scope("kernel", 4, 2, 3, 48, 160, 0, registry);
+        }
+
+        auto stats = registry.snapshot();
+        REQUIRE(stats.size() == 1);
+
+        const KernelStats& s = stats[0].second;
+        REQUIRE(stats[0].first.name == "kernel");
+        REQUIRE(stats[0].first.inner == 3);
+        REQUIRE(s.calls == 3);
+        REQUIRE(s.flops == 3 * 48);
+        REQUIRE(s.bytes == 3 * 160);
+        REQUIRE(s.min_ns <= s.max_ns);
+        REQUIRE(s.total_ns >= s.max_ns);
+
+        unsigned long long histogram_calls = 0;
+        for (auto count : s.histogram) { histogram_calls += count; }
+        REQUIRE(histogram_calls == 3);
+    }
+    SECTION("Work can be set after the kernel finishes")
+    {
+        {
+            KernelScope scope("build", 5, 5, 0, 0, 0, 0, registry);
+            scope.work(0, 100, 7);
+        }
+
+        const KernelStats s = registry.snapshot()[0].second;
+        REQUIRE(s.bytes == 100);
+        REQUIRE(s.nnz == 7);
+    }
+    SECTION("Shapes are kept apart and reset clears them")
+    {
+        { KernelScope scope("kernel", 4, 4, 0, 0, 0, 0, registry); }
+        { KernelScope scope("kernel", 8, 8, 0, 0, 0, 0, registry); }
+        { KernelScope scope("other",  4, 4, 0, 0, 0, 0, registry); }
+
+        REQUIRE(registry.snapshot().size() == 3);
+
+        registry.reset();
+
+        REQUIRE(registry.snapshot().empty());
+    }
+    SECTION("Names are merged by content, not by address")
+    {
+        const char first[]  = "kernel";
+        const char second[] = "kernel";
+
+        { KernelScope scope(first,  4, 4, 0, 0, 0, 0, registry); }
+        { KernelScope scope(second, 4, 4, 0, 0, 0, 0, registry); }
+
+        auto stats = registry.snapshot();
+        REQUIRE(stats.size() == 1);
+        REQUIRE(stats[0].second.calls == 2);
+    }
+    SECTION("Calls from several threads are merged in the snapshot")
+    {
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&registry]
+            {
+                for (unsigned i = 0; i < 100; ++i)
+                {
+                    KernelScope scope("kernel", 4, 4, 0, 2, 8, 1, registry);
+                }
+            });
+        }
+        for (std::thread& thread : threads) { thread.join(); }
+
+        auto stats = registry.snapshot();
+        REQUIRE(stats.size() == 1);
+
+        const KernelStats& s = stats[0].second;
+        REQUIRE(s.calls == 400);
+        REQUIRE(s.flops == 800);
+        REQUIRE(s.bytes == 3200);
+        REQUIRE(s.nnz   == 400);
+    }
+}
+
+TEST_CASE("Kernel time histograms", "[histogram], [instrumentation]")
+{
+    KernelRegistry registry;
+    KernelKey      key { "kernel", 1, 1, 0 };
+
+    KernelSample sample;
+    for (std::uint64_t ns : { 1, 3, 5, 6, 1000 })
+    {
+        sample.ns = ns;
+        registry.record(key, sample);
+    }
+
+    const KernelStats s = registry.snapshot()[0].second;
+
+    REQUIRE(s.histogram[0] == 1);  // 1
+    REQUIRE(s.histogram[1] == 1);  // 3
+    REQUIRE(s.histogram[2] == 2);  // 5, 6
+    REQUIRE(s.histogram[9] == 1);  // 1000
+    REQUIRE(s.min_ns == 1);
+    REQUIRE(s.max_ns == 1000);
+
+    REQUIRE(s.quantile_ns(0.5) == 7);
+    REQUIRE(s.quantile_ns(1.0) == 1023);
+}
+
+TEST_CASE("Dumping kernel statistics", "[output], [instrumentation]")
+{
+    KernelRegistry registry;
+
+    KernelSample sample;
+    sample.ns    = 2000;
+    sample.flops = 4000;
+    sample.bytes = 1000;
+    registry.record(KernelKey{ "FMatrix::multiply", 10, 10, 20 }, sample);
+
+    SECTION("JSON holds the counters and derived rates")
+    {
+        std::ostringstream out;
+        registry.dump_json(out);
+
+        const std::string json = out.str();
+        REQUIRE(json.find("{\"kernels\":[{\"name\":\"FMatrix::multiply\"") == 0);
+        REQUIRE(json.find("\"inner\":20") != std::string::npos);
+        REQUIRE(json.find("\"calls\":1") != std::string::npos);
+        REQUIRE(json.find("\"gflops\":2") != std::string::npos);
+        REQUIRE(json.find("\"intensity\":4") != std::string::npos);
+        REQUIRE(json.find("\"perf\"") == std::string::npos);
+    }
+    SECTION("The text report has one line per kernel shape")
+    {
+        std::ostringstream out;
+        registry.report(out);
+
+        const std::string text = out.str();
+        REQUIRE(text.find("FMatrix::multiply") != std::string::npos);
+        REQUIRE(text.find("10x10x20") != std::string::npos);
+        REQUIRE(std::count(text.begin(), text.end(), '\n') == 2);
+    }
+}
+
+#ifndef MATRIX_CPP_INSTRUMENT
+TEST_CASE("Kernels record nothing when instrumentation is off", "[disabled], [instrumentation]")
+{
+    KernelRegistry::instance().reset();
+
+    FMatrix<2, 2> A { 1, 2
+                    , 3, 4 };
+    CSRMatrix<2, 2> S(A);
+
+    (void)(A * A);
+    (void)(S * A);
+    (void)S.transpose();
+
+    REQUIRE(KernelRegistry::instance().snapshot().empty());
+}
+#else
+TEST_CASE("Kernels record their work when instrumentation is on", "[enabled], [instrumentation]")
+{
+    KernelRegistry::instance().reset();
+
+    FMatrix<2, 3> A { 1, 0, 3
+                    , 0, 5, 6 };
+    FMatrix<3, 4> B;
+    CSRMatrix<2, 3> S(A);
+
+    (void)(A * B);
+    (void)(S * B);
+
+    auto stats = KernelRegistry::instance().snapshot();
+    auto find  = [&](const std::string& name)
+    {
+        return std::find_if(stats.begin(), stats.end(),
+                            [&](const auto& entry) { return entry.first.name == name; });
+    };
+
+    SECTION("Dense products count 2nmp FLOPs and every operand once")
+    {
+        const auto entry = find("FMatrix::multiply");
+        REQUIRE(entry != stats.end());
+
+        REQUIRE(entry->first.rows  == 2);
+        REQUIRE(entry->first.cols  == 4);
+        REQUIRE(entry->first.inner == 3);
+        REQUIRE(entry->second.calls == 1);
+        REQUIRE(entry->second.flops == 2 * 2 * 3 * 4);
+        REQUIRE(entry->second.bytes == sizeof(double) * (6 + 12 + 8));
+    }
+    SECTION("Sparse products count 2 nnz p FLOPs and the CSR arrays once")
+    {
+        const auto entry = find("CSRMatrix::multiply");
+        REQUIRE(entry != stats.end());
+
+        REQUIRE(entry->first.inner == 3);
+        REQUIRE(entry->second.calls == 1);
+        REQUIRE(entry->second.nnz   == 4);
+        REQUIRE(entry->second.flops == 2 * 4 * 4);
+        REQUIRE(entry->second.bytes == (sizeof(double) + sizeof(unsigned)) * 4 + sizeof(unsigned) * 3
+                                    + sizeof(double) * (12 + 8));
+    }
+    SECTION("Views, mapped matrices and pooled products record the same kernels")
+    {
+        const std::string path = (std::filesystem::temp_directory_path()
+                                  / "instrumentation_tests_mapped.bin").string();
+        write_matrix(path, S);
+
+        KernelRegistry::instance().reset();
+
+        (void)(A.view() * B.view());
+        (void)(MappedCSRMatrix<2, 3>(path) * B);
+
+        CSRMatrix<3, 3> D(FMatrix<3, 3> { 2, 0, 0
+                                        , 0, 3, 0
+                                        , 0, 0, 4 });
+        ThreadPool   pool(2);
+        EigenOptions options;
+        options.pool = &pool;
+        (void)power_iteration(D, options);
+
+        stats = KernelRegistry::instance().snapshot();
+
+        const auto dense = find("FMatrix::multiply");
+        REQUIRE(dense != stats.end());
+        REQUIRE(dense->second.flops == 2 * 2 * 3 * 4);
+
+        auto sparse = std::find_if(stats.begin(), stats.end(), [](const auto& entry)
+        {
+            return entry.first.name == "CSRMatrix::multiply" && entry.first.rows == 2;
+        });
+        REQUIRE(sparse != stats.end());
+        REQUIRE(sparse->second.flops == 2 * 4 * 4);
+
+        auto pooled = std::find_if(stats.begin(), stats.end(), [](const auto& entry)
+        {
+            return entry.first.name == "CSRMatrix::multiply" && entry.first.rows == 3;
+        });
+        REQUIRE(pooled != stats.end());
+        REQUIRE(pooled->second.nnz == 3 * pooled->second.calls);
+
+        std::remove(path.c_str());
+    }
+    SECTION("Building a CSR matrix records the nnz it found")
+    {
+        const auto entry = find("CSRMatrix::CSRMatrix");
+        REQUIRE(entry != stats.end());
+
+        REQUIRE(entry->second.calls == 1);
+        REQUIRE(entry->second.nnz   == 4);
+    }
+}
+#endif
@@ -0,0 +1,202 @@
+/*
+
+File: matrix_file_tests.cpp
+
+Brief: Unit tests for the binary matrix file format and mapped readers
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <filesystem>
+#include <catch.hpp>
+#include <fmatrix.hpp>
+#include <csr_matrix.hpp>
+#include <matrix_file.hpp>
+
+static std::string temp_path(const std::string& name)
+{
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+TEST_CASE("Dense matrix files", "[dense], [matrix_file]")
+{
+    const std::string path = temp_path("matrix_file_tests_dense.bin");
+
+    FMatrix<3,2> A { 1, 2
+                   , 3, 4
+                   , 5, 6 };
+
+    write_matrix(path, A);
+
+    SECTION("A mapped dense matrix reads back the written values")
+    {
+        MappedFMatrix<3,2> mapped(path);
+
+        REQUIRE(mapped.to_fmatrix() == A);
+        REQUIRE(mapped[2][1] == 6);
+        REQUIRE(mapped.at(1, 0) == 3);
+    }
+    SECTION("Mapped dense matrices multiply in place")
+    {
+        MappedFMatrix<3,2> mapped(path);
+
+        FMatrix<2,2> B { 1, 0
+                       , 0, 1 };
+
+        REQUIRE(mapped * B == A);
+    }
+    SECTION("Rewriting a file leaves existing mappings intact")
+    {
+        MappedFMatrix<3,2> mapped(path);
+
+        write_matrix(path, A * 2);
+
+        REQUIRE(mapped.to_fmatrix() == A);
+        REQUIRE(MappedFMatrix<3,2>(path).to_fmatrix() == A * 2);
+        REQUIRE_FALSE(std::filesystem::exists(path + ".tmp." + std::to_string(::getpid())));
+    }
+    SECTION("Reading with the wrong dimensions throws")
+    {
+        REQUIRE_THROWS_AS((MappedFMatrix<2,3>(path)), std::runtime_error);
+    }
+    SECTION("Reading a dense file as CSR throws")
+    {
+        REQUIRE_THROWS_AS((MappedCSRMatrix<3,2>(path)), std::runtime_error);
+    }
+    SECTION("A dense header with the wrong entry count throws")
+    {
+        MatrixFileHeader header;
+        header.kind        = static_cast<std::uint32_t>(MatrixFileKind::Dense);
+        header.rows        = 3;
+        header.cols        = 2;
+        header.nnz         = 0;
+        header.vals_offset = sizeof(MatrixFileHeader);
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        }
+        REQUIRE_THROWS_AS((MappedFMatrix<3,2>(path)), std::runtime_error);
+    }
+    SECTION("An entry count that overflows the section size throws")
+    {
+        MatrixFileHeader header;
+        header.kind        = static_cast<std::uint32_t>(MatrixFileKind::CSR);
+        header.rows        = 3;
+        header.cols        = 2;
+        header.nnz         = (std::uint64_t(1) << 61) + 1;
+        header.row_offset  = sizeof(MatrixFileHeader);
+        header.cols_offset = sizeof(MatrixFileHeader);
+        header.vals_offset = sizeof(MatrixFileHeader);
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file << std::string(MATRIX_FILE_ALIGNMENT, '\0');
+        }
+        REQUIRE_THROWS_AS((MappedCSRMatrix<3,2>(path)), std::runtime_error);
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("CSR matrix files", "[csr], [matrix_file]")
+{
+    const std::string path = temp_path("matrix_file_tests_csr.bin");
+
+    CSRMatrix<4,5> A { 0, 0, 0, 0, 0
+                     , 5, 8, 0, 0, 0
+                     , 0, 0, 0, 0, 0
+                     , 0, 0, 2, 0, 6 };
+
+    write_matrix(path, A);
+
+    SECTION("A mapped CSR matrix converts back to an identical CSR matrix")
+    {
+        MappedCSRMatrix<4,5> mapped(path);
+
+        REQUIRE(mapped.nnz() == A.nnz());
+        REQUIRE(mapped.to_csr() == A);
+        REQUIRE(mapped.to_fmatrix() == A.to_fmatrix());
+    }
+    SECTION("Mapped CSR matrices multiply without copying")
+    {
+        MappedCSRMatrix<4,5> mapped(path);
+
+        FMatrix<5,2> B { 1, 2
+                       , 3, 4
+                       , 5, 6
+                       , 7, 8
+                       , 9, 0 };
+
+        REQUIRE(mapped * B == A * B);
+    }
+    SECTION("Copies share the mapping")
+    {
+        MappedCSRMatrix<4,5> mapped(path);
+        MappedCSRMatrix<4,5> copy(mapped);
+
+        REQUIRE(copy._vals == mapped._vals);
+    }
+    SECTION("Row offsets are padded with zeros, not the bytes that follow them")
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        const std::size_t row_end = sizeof(MatrixFileHeader) + 5 * sizeof(unsigned);
+        const std::size_t padding = sizeof(MatrixFileHeader) + MATRIX_FILE_ALIGNMENT - row_end;
+
+        REQUIRE(bytes.size() > row_end + padding);
+        REQUIRE(bytes.compare(row_end, padding, std::string(padding, '\0')) == 0);
+    }
+    SECTION("Truncated files throw")
+    {
+        std::filesystem::resize_file(path, sizeof(MatrixFileHeader) + 8);
+
+        REQUIRE_THROWS_AS((MappedCSRMatrix<4,5>(path)), std::runtime_error);
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("CSR matrix files with a row section that needs padding", "[csr], [matrix_file]")
+{
+    const std::string path = temp_path("matrix_file_tests_csr_padded.bin");
+
+    // 17 row offsets end partway through an alignment block
+    FMatrix<16,16> dense;
+    for (unsigned i = 0; i < 16; ++i)
+    {
+        dense[i][(i * 7) % 16] = i + 1.0;
+    }
+    CSRMatrix<16,16> A(dense);
+
+    write_matrix(path, A);
+
+    MappedCSRMatrix<16,16> mapped(path);
+
+    REQUIRE(mapped.to_csr() == A);
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Opening matrix files", "[errors], [matrix_file]")
+{
+    SECTION("A missing file throws a system error")
+    {
+        REQUIRE_THROWS_AS((MappedCSRMatrix<2,2>(temp_path("matrix_file_tests_missing.bin"))),
+                          std::system_error);
+    }
+    SECTION("A file without the magic number throws")
+    {
+        const std::string path = temp_path("matrix_file_tests_garbage.bin");
+        {
+            std::ofstream file(path, std::ios::binary);
+            file << std::string(sizeof(MatrixFileHeader), 'x');
+        }
+        REQUIRE_THROWS_AS((MappedFMatrix<2,2>(path)), std::runtime_error);
+
+        std::remove(path.c_str());
+    }
+}
@@ -0,0 +1,228 @@
+/*
+
+File: matrix_market_tests.cpp
+
+Brief: Unit tests for the Matrix Market reader and writer
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <filesystem>
+#include <catch.hpp>
+#include <fmatrix.hpp>
+#include <csr_matrix.hpp>
+#include <matrix_market.hpp>
+
+static std::string write_temp(const std::string& name, const std::string& contents)
+{
+    std::string path = (std::filesystem::temp_directory_path() / name).string();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << contents;
+    return path;
+}
+
+TEST_CASE("Reading Matrix Market files", "[read], [matrix_market]")
+{
+    FMatrix<4,5> expected { 0, 0, 0, 0,   0
+                          , 5, 8, 0, 0,   0
+                          , 0, 0, 0, 0,   0
+                          , 0, 0, 2, 0, 6.5 };
+
+    SECTION("General real files with unordered entries and comments")
+    {
+        std::string path = write_temp("matrix_market_tests_general.mtx",
+            "%%MatrixMarket matrix coordinate real general\n"
+            "% a comment\n"
+            "\n"
+            "4 5 4\n"
+            "4 5 6.5\n"
+            "2 2 8\n"
+            "4 3 +2.0e0\n"
+            "2 1 5\n");
+
+        REQUIRE(read_matrix_market<4,5>(path).to_fmatrix() == expected);
+        REQUIRE(read_matrix_market<4,5>(path) == CSRMatrix<4,5>(expected));
+
+        std::remove(path.c_str());
+    }
+    SECTION("Parsing in parallel gives the same matrix")
+    {
+        std::string path = write_temp("matrix_market_tests_parallel.mtx",
+            "%%MatrixMarket matrix coordinate real general\r\n"
+            "4 5 4\r\n"
+            "2 1 5\r\n"
+            "2 2 8\r\n"
+            "4 3 2\r\n"
+            "4 5 6.5\r\n");
+
+        REQUIRE(read_matrix_market<4,5>(path, 3) == read_matrix_market<4,5>(path));
+        REQUIRE(read_matrix_market<4,5>(path, 16).to_fmatrix() == expected);
+
+        std::remove(path.c_str());
+    }
+    SECTION("Symmetric files store both triangles")
+    {
+        std::string path = write_temp("matrix_market_tests_symmetric.mtx",
+            "%%MatrixMarket matrix coordinate integer symmetric\n"
+            "3 3 3\n"
+            "1 1 4\n"
+            "3 1 2\n"
+            "3 2 7\n");
+
+        FMatrix<3,3> S { 4, 0, 2
+                       , 0, 0, 7
+                       , 2, 7, 0 };
+
+        REQUIRE(read_matrix_market<3,3>(path).to_fmatrix() == S);
+
+        std::remove(path.c_str());
+    }
+    SECTION("Skew-symmetric files negate the mirrored triangle")
+    {
+        std::string path = write_temp("matrix_market_tests_skew.mtx",
+            "%%MatrixMarket matrix coordinate real skew-symmetric\n"
+            "2 2 1\n"
+            "2 1 3\n");
+
+        FMatrix<2,2> K {  0, -3
+                       ,  3,  0 };
+
+        REQUIRE(read_matrix_market<2,2>(path).to_fmatrix() == K);
+
+        std::remove(path.c_str());
+    }
+    SECTION("Pattern files store ones")
+    {
+        std::string path = write_temp("matrix_market_tests_pattern.mtx",
+            "%%MatrixMarket matrix coordinate pattern general\n"
+            "2 2 2\n"
+            "1 2\n"
+            "2 1\n");
+
+        FMatrix<2,2> P { 0, 1
+                       , 1, 0 };
+
+        REQUIRE(read_matrix_market<2,2>(path).to_fmatrix() == P);
+
+        std::remove(path.c_str());
+    }    SECTION("Repeated coordinates are summed into one entry")
+    {
+        std::string path = write_temp("matrix_market_tests_duplicates.mtx",
+            "%%MatrixMarket matrix coordinate real general\n"
+            "3 3 6\n"
+            "1 1 2\n"
+            "3 2 1\n"
+            "1 1 3\n"
+            "2 3 4\n"
+            "3 2 1\n"
+            "1 3 5\n");
+
+        FMatrix<3,3> D { 5, 0, 5
+                       , 0, 0, 4
+                       , 0, 2, 0 };
+
+        CSRMatrix<3,3> A = read_matrix_market<3,3>(path);
+
+        REQUIRE(A.nnz() == 4);
+        REQUIRE(A == CSRMatrix<3,3>(D));
+        FMatrix<3,3> I { 1, 0, 0
+                       , 0, 1, 0
+                       , 0, 0, 1 };
+
+        REQUIRE(A * I == D);
+        REQUIRE(read_matrix_market<3,3>(path, 4) == A);
+
+        std::remove(path.c_str());
+    }
+    SECTION("Symmetric files that store both triangles sum the mirrored entries")
+    {
+        std::string path = write_temp("matrix_market_tests_symmetric_both.mtx",
+            "%%MatrixMarket matrix coordinate real symmetric\n"
+            "2 2 2\n"
+            "1 2 1\n"
+            "2 1 1\n");
+
+        CSRMatrix<2,2> A = read_matrix_market<2,2>(path);
+
+        REQUIRE(A.nnz() == 2);
+        REQUIRE(A.to_fmatrix() == FMatrix<2,2> { 0, 2
+                                               , 2, 0 });
+
+        std::remove(path.c_str());
+    }
+}
+
+TEST_CASE("Malformed Matrix Market files", "[errors], [matrix_market]")
+{
+    auto require_throws = [](const std::string& contents)
+    {
+        std::string path = write_temp("matrix_market_tests_error.mtx", contents);
+
+        REQUIRE_THROWS_AS((read_matrix_market<2,2>(path)), std::runtime_error);
+
+        std::remove(path.c_str());
+    };
+
+    SECTION("Mismatched dimensions")
+    {
+        require_throws("%%MatrixMarket matrix coordinate real general\n3 3 0\n");
+    }
+    SECTION("Entry count differs from the size line")
+    {
+        require_throws("%%MatrixMarket matrix coordinate real general\n2 2 2\n1 1 1\n");
+    }
+    SECTION("Index out of range")
+    {
+        require_throws("%%MatrixMarket matrix coordinate real general\n2 2 1\n3 1 1\n");
+    }
+    SECTION("Missing value")
+    {
+        require_throws("%%MatrixMarket matrix coordinate real general\n2 2 1\n1 1\n");
+    }
+    SECTION("Complex fields are unsupported")
+    {
+        require_throws("%%MatrixMarket matrix coordinate complex general\n2 2 0\n");
+    }
+    SECTION("Array format is unsupported")
+    {
+        require_throws("%%MatrixMarket matrix array real general\n2 2\n");
+    }
+    SECTION("Missing banner")
+    {
+        require_throws("2 2 0\n");
+    }
+}
+
+TEST_CASE("Writing Matrix Market files", "[write], [matrix_market]")
+{
+    std::string path = (std::filesystem::temp_directory_path()
+                        / "matrix_market_tests_write.mtx").string();
+
+    CSRMatrix<3,4> A { 1.5, 0, 0, -2
+                     , 0,   0, 0,  0
+                     , 0, 1e-300, 3, 0 };
+
+    write_matrix_market(path, A);
+
+    SECTION("Written files read back exactly")
+    {
+        REQUIRE(read_matrix_market<3,4>(path) == A);
+    }
+    SECTION("Written files use one based general coordinates")
+    {
+        std::ifstream file(path);
+        std::string banner, size;
+        std::getline(file, banner);
+        std::getline(file, size);
+
+        REQUIRE(banner == "%%MatrixMarket matrix coordinate real general");
+        REQUIRE(size == "3 4 4");
+    }
+    std::remove(path.c_str());
+}
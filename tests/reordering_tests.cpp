@@ -0,0 +1,132 @@
+/*
+
+File: reordering_tests.cpp
+
+Brief: Unit tests for CSR matrix reorderings and partitions
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#include <catch.hpp>
+#include <fmatrix.hpp>
+#include <csr_matrix.hpp>
+#include <reordering.hpp>
+
+TEST_CASE("Constructing permutations", "[constructors], [reordering]")
+{
+    SECTION("Default permutation is the identity")
+    {
+        Permutation<3> P;
+
+        REQUIRE(P._perm  == std::vector<unsigned> { 0, 1, 2 });
+        REQUIRE(P._iperm == std::vector<unsigned> { 0, 1, 2 });
+    }
+    SECTION("The inverse permutation is computed on construction")
+    {
+        Permutation<3> P({ 2, 0, 1 });
+
+        REQUIRE(P._iperm == std::vector<unsigned> { 1, 2, 0 });
+        REQUIRE(P.inverse()._perm == P._iperm);
+    }
+    SECTION("Repeated indices throw")
+    {
+        REQUIRE_THROWS_AS(Permutation<3>({ 0, 0, 1 }), std::invalid_argument);
+    }
+    SECTION("Out of range indices throw")
+    {
+        REQUIRE_THROWS_AS(Permutation<3>({ 0, 1, 3 }), std::invalid_argument);
+    }
+}
+
+TEST_CASE("Reverse Cuthill-McKee ordering", "[rcm], [reordering]")
+{
+    // A path graph 0-4-1-3-2 numbered to scatter entries away from the diagonal
+    CSRMatrix<5,5> A { 4, 0, 0, 0, 1
+                     , 0, 4, 0, 1, 1
+                     , 0, 0, 4, 1, 0
+                     , 0, 1, 1, 4, 0
+                     , 1, 1, 0, 0, 4 };
+
+    Permutation<5> P = rcm_ordering(A);
+    CSRMatrix<5,5> B = permute(A, P);
+
+    SECTION("RCM reduces the bandwidth of a path graph to one")
+    {
+        REQUIRE(bandwidth(A) == 4);
+        REQUIRE(bandwidth(B) == 1);
+    }
+    SECTION("Reordering preserves the nonzeros")
+    {
+        REQUIRE(B.nnz() == A.nnz());
+    }
+    SECTION("Multiplying in the reordered system gives the same product")
+    {
+        FMatrix<5,2> X { 1, 2
+                       , 3, 4
+                       , 5, 6
+                       , 7, 8
+                       , 9, 0 };
+
+        REQUIRE(unpermute(B * permute(X, P), P) == A * X);
+    }
+    SECTION("Disconnected components are all ordered")
+    {
+        CSRMatrix<4,4> C { 1, 0, 1, 0
+                         , 0, 1, 0, 0
+                         , 1, 0, 1, 0
+                         , 0, 0, 0, 1 };
+
+        REQUIRE_NOTHROW(rcm_ordering(C));
+        REQUIRE(permute(C, rcm_ordering(C)).nnz() == C.nnz());
+    }
+}
+
+TEST_CASE("Degree ordering", "[degree], [reordering]")
+{
+    CSRMatrix<3,3> A { 1, 1, 1
+                     , 0, 1, 0
+                     , 1, 0, 1 };
+
+    REQUIRE(degree_ordering(A)._perm == std::vector<unsigned> { 1, 2, 0 });
+}
+
+TEST_CASE("Permuting vectors", "[permute], [reordering]")
+{
+    Permutation<3> P({ 2, 0, 1 });
+
+    CVector<3> x { 10, 20, 30 };
+    CVector<3> y { 30, 10, 20 };
+
+    REQUIRE(permute(x, P) == y);
+    REQUIRE(unpermute(y, P) == x);
+}
+
+TEST_CASE("Partitioning rows by nonzeros", "[partition], [reordering]")
+{
+    CSRMatrix<4,4> A { 1, 1, 1, 1
+                     , 1, 0, 0, 0
+                     , 1, 1, 0, 0
+                     , 1, 0, 0, 0 };
+
+    SECTION("Partition bounds cover every row")
+    {
+        std::vector<unsigned> bounds = nnz_partition(A, 2);
+
+        REQUIRE(bounds.front() == 0);
+        REQUIRE(bounds.back()  == 4);
+    }
+    SECTION("Heavy rows get their own partition")
+    {
+        REQUIRE(nnz_partition(A, 2) == std::vector<unsigned> { 0, 1, 4 });
+    }
+    SECTION("More partitions than rows leaves trailing partitions empty")
+    {
+        std::vector<unsigned> bounds = nnz_partition(A, 8);
+
+        REQUIRE(bounds.size() == 9);
+        REQUIRE(std::is_sorted(bounds.begin(), bounds.end()));
+    }
+}
@@ -0,0 +1,213 @@
+/*
+
+File: triangular_solver_tests.cpp
+
+Brief: Unit tests for the level-scheduled sparse triangular solver
+
+Authors: Alexander DuPree
+
+https://github.com/AlexanderJDupree/matrix-cpp
+
+*/
+
+#include <catch.hpp>
+#include <fmatrix.hpp>
+#include <parallel.hpp>
+#include <csr_matrix.hpp>
+#include <triangular_solver.hpp>
+
+TEST_CASE("Triangular solver analysis", "[analysis], [triangular_solver]")
+{
+    SECTION("A diagonal matrix is solved in a single level")
+    {
+        CSRMatrix<3,3> D { 2, 0, 0
+                         , 0, 4, 0
+                         , 0, 0, 8 };
+
+        TriangularSolver<3> solver(D, Triangle::Lower);
+
+        REQUIRE(solver.levels() == 1);
+    }
+    SECTION("A bidiagonal matrix has one level per row")
+    {
+        CSRMatrix<4,4> L { 1, 0, 0, 0
+                         , 1, 1, 0, 0
+                         , 0, 1, 1, 0
+                         , 0, 0, 1, 1 };
+
+        TriangularSolver<4> solver(L, Triangle::Lower);
+
+        REQUIRE(solver.levels() == 4);
+    }
+    SECTION("Independent rows share a level")
+    {
+        CSRMatrix<4,4> L { 1, 0, 0, 0
+                         , 0, 1, 0, 0
+                         , 1, 1, 1, 0
+                         , 1, 0, 0, 1 };
+
+        TriangularSolver<4> solver(L, Triangle::Lower);
+
+        REQUIRE(solver.levels() == 2);
+    }
+    SECTION("A missing diagonal entry throws")
+    {
+        CSRMatrix<2,2> L { 1, 0
+                         , 1, 0 };
+
+        REQUIRE_THROWS_AS(TriangularSolver<2>(L, Triangle::Lower), std::domain_error);
+    }
+    SECTION("A missing diagonal entry is allowed with a unit diagonal")
+    {
+        CSRMatrix<2,2> L { 0, 0
+                         , 1, 0 };
+
+        REQUIRE_NOTHROW(TriangularSolver<2>(L, Triangle::Lower, Diagonal::Unit));
+    }
+}
+
+TEST_CASE("Triangular solves", "[solve], [triangular_solver]")
+{
+    CSRMatrix<4,4> LU { 2, 1, 0, 3
+                      , 1, 4, 2, 0
+                      , 0, 3, 1, 1
+                      , 2, 0, 1, 8 };
+
+    FMatrix<4,2> B { 2, 4
+                   , 5, 1
+                   , 7, 0
+                   , 9, 3 };
+
+    SECTION("Lower triangular solve ignores the upper triangle")
+    {
+        CSRMatrix<4,4> L { 2, 0, 0, 0
+                         , 1, 4, 0, 0
+                         , 0, 3, 1, 0
+                         , 2, 0, 1, 8 };
+
+        TriangularSolver<4> solver(LU, Triangle::Lower);
+
+        REQUIRE(L * solver.solve(LU, B) == B);
+    }
+    SECTION("Upper triangular solve ignores the lower triangle")
+    {
+        CSRMatrix<4,4> U { 2, 1, 0, 3
+                         , 0, 4, 2, 0
+                         , 0, 0, 1, 1
+                         , 0, 0, 0, 8 };
+
+        TriangularSolver<4> solver(LU, Triangle::Upper);
+
+        REQUIRE(U * solver.solve(LU, B) == B);
+    }
+    SECTION("Unit diagonal solve treats the diagonal as ones")
+    {
+        CSRMatrix<4,4> L { 1, 0, 0, 0
+                         , 1, 1, 0, 0
+                         , 0, 3, 1, 0
+                         , 2, 0, 1, 1 };
+
+        TriangularSolver<4> solver(LU, Triangle::Lower, Diagonal::Unit);
+
+        REQUIRE(L * solver.solve(LU, B) == B);
+    }
+    SECTION("Solving on a pool matches the sequential solve")
+    {
+        TriangularSolver<4> solver(LU, Triangle::Lower);
+        ThreadPool pool(4);
+
+        REQUIRE(solver.solve(LU, B, &pool) == solver.solve(LU, B));
+    }
+    SECTION("The schedule is reused for new values with the same pattern")
+    {
+        TriangularSolver<4> solver(LU, Triangle::Upper);
+
+        CSRMatrix<4,4> scaled = LU * 2;
+
+        REQUIRE(solver.solve(scaled, B * 2) == solver.solve(LU, B));
+    }
+    SECTION("Solving with a different pattern throws")
+    {
+        TriangularSolver<4> solver(LU, Triangle::Lower);
+
+        CSRMatrix<4,4> I { 1, 0, 0, 0
+                         , 0, 1, 0, 0
+                         , 0, 0, 1, 0
+                         , 0, 0, 0, 1 };
+
+        REQUIRE_THROWS_AS(solver.solve(I, B), std::invalid_argument);
+    }
+    SECTION("Solving with a different pattern of the same size throws")
+    {
+        CSRMatrix<3,3> L { 2, 0, 0
+                         , 1, 2, 0
+                         , 0, 0, 2 };
+
+        CSRMatrix<3,3> K { 2, 0, 0
+                         , 0, 2, 0
+                         , 1, 0, 2 };
+
+        TriangularSolver<3> solver(L, Triangle::Lower);
+
+        REQUIRE_THROWS_AS(solver.solve(K, FMatrix<3,1> { 2, 2, 2 }), std::invalid_argument);
+    }
+    SECTION("A zero pivot in the new values throws")
+    {
+        TriangularSolver<4> solver(LU, Triangle::Lower);
+
+        CSRMatrix<4,4> singular = LU;
+        singular._vals[singular._row[2] + 1] = 0; // LU[2][2]
+
+        REQUIRE_THROWS_AS(solver.solve(singular, B), std::domain_error);
+        REQUIRE_NOTHROW(TriangularSolver<4>(LU, Triangle::Lower, Diagonal::Unit).solve(singular, B));
+    }
+    SECTION("Solving without an analysis throws")
+    {
+        TriangularSolver<4> solver;
+
+        REQUIRE_THROWS_AS(solver.solve(LU, B), std::invalid_argument);
+    }
+}
+
+TEST_CASE("Threaded triangular solves", "[threads], [triangular_solver]")
+{
+    // Sparse random lower triangle, most levels hold many independent rows
+    FMatrix<200,200> dense;
+    unsigned seed = 12345;
+    for (unsigned i = 0; i < 200; ++i)
+    {
+        dense[i][i] = 4.0 + (i % 5);
+        for (unsigned j = 0; j < i; ++j)
+        {
+            seed = seed * 1103515245 + 12345;
+            if ((seed >> 16) % 64 == 0) { dense[i][j] = 1.0 + ((seed >> 8) % 7); }
+        }
+    }
+    CSRMatrix<200,200> L(dense);
+
+    FMatrix<200,3> B;
+    for (unsigned i = 0; i < 200; ++i)
+    {
+        for (unsigned c = 0; c < 3; ++c) { B[i][c] = (i + 1.0) * (c + 1); }
+    }
+
+    TriangularSolver<200> solver(L, Triangle::Lower);
+
+    REQUIRE(solver.levels() < 100);
+
+    const FMatrix<200,3> X = solver.solve(L, B);
+
+    SECTION("Four threads match the sequential solve")
+    {
+        ThreadPool pool(4);
+
+        REQUIRE(solver.solve(L, B, &pool) == X);
+        REQUIRE(solver.solve(L, B, &pool) == X); // The pool is reused
+    }
+    SECTION("Eight threads match the sequential solve")
+    {
+        ThreadPool pool(8);
+
+        REQUIRE(solver.solve(L, B, &pool) == X);
+    }
+}